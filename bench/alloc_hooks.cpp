@@ -0,0 +1,3 @@
+// The allocation hooks of slog_bench_alloc, kept out of slog_bench so its other modes run without them
+#define SLOG_ALLOCATION_HOOKS
+#include "slog.h"
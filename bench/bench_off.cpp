@@ -0,0 +1,5 @@
+// The cases of slog_bench with slog compiled out
+#undef _ENABLE_SLOG
+
+#define SLOG_BENCH_CASES runCompiledOutCases
+#include "bench/cases.h"
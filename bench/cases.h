@@ -0,0 +1,85 @@
+/*
+ @ brief:   Calls measured by slog_bench
+            Included once with slog enabled and once with it compiled out, SLOG_BENCH_CASES names the entry
+ */
+
+#include "slog.h"
+#include "bench/harness.h"
+
+namespace
+{
+    BENCH_NOINLINE int add(int a, int b)
+    {
+        return a + b;
+    }
+
+    class Accumulator
+    {
+    private:
+        int _total = 0;
+
+    public:
+        BENCH_NOINLINE int add(int a, int b)
+        {
+            _total += a + b;
+            return _total;
+        }
+    };
+
+    BENCH_NOINLINE int scopedAdd(int a, int b)
+    {
+        SENTRY
+
+        return add(a, b);
+
+        SLEAVE(0)
+    }
+}
+
+// Every case once, all threads run the same call site
+void SLOG_BENCH_CASES(bench::Runner &runner, const char *mode, const char *sink, int threads)
+{
+    runner.run("plain", mode, sink, threads, [](uint64_t n)
+               {
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(add(static_cast<int>(i), 1)); });
+
+    runner.run("SFUNC_RUN", mode, sink, threads, [](uint64_t n)
+               {
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(SFUNC_RUN(add, static_cast<int>(i), 1)); });
+
+    runner.run("SFUNC_DEC", mode, sink, threads, [](uint64_t n)
+               {
+        auto decorated = SFUNC_DEC(add);
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(decorated(static_cast<int>(i), 1)); });
+
+    runner.run("SFUNC_MEM_RUN", mode, sink, threads, [](uint64_t n)
+               {
+        Accumulator acc;
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(SFUNC_MEM_RUN(acc, Accumulator::add, static_cast<int>(i), 1)); });
+
+    runner.run("SFUNC_MEM_DEC", mode, sink, threads, [](uint64_t n)
+               {
+        Accumulator acc;
+        auto decorated = SFUNC_MEM_DEC(acc, Accumulator::add);
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(decorated(static_cast<int>(i), 1)); });
+
+    runner.run("SENTRY/SLEAVE", mode, sink, threads, [](uint64_t n)
+               {
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(scopedAdd(static_cast<int>(i), 1)); });
+
+    runner.run("STASK", mode, sink, threads, [](uint64_t n)
+               {
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(STASK(add, static_cast<int>(i), 1)()); });
+
+    runner.run("SACTION", mode, sink, threads, [](uint64_t n)
+               {
+        for (uint64_t i = 0; i < n; ++i)
+            bench::doNotOptimize(SACTION(add(static_cast<int>(i), 1))); });
+}
@@ -0,0 +1,97 @@
+#!/usr/bin/env bash
+#
+# @ brief:   Build time and size of files using slog.h against the same files using slog_lite.h and the slog library
+# @ usage:   bench/compile_bench.sh [files] [functions]
+#            Run from the repository root, CXX and CXXFLAGS pick the compiler and its options
+#
+set -e
+
+FILES=${1:-8}
+FUNCS=${2:-20}
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+ROOT=$(pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# One file with FUNCS functions of distinct signatures, each decorated in every way
+generate()
+{
+    local header=$1 index=$2
+    echo "#include \"$header\""
+    echo "#include <string>"
+    for ((i = 0; i < FUNCS; ++i)); do
+        cat <<EOF
+struct Arg${index}_$i { int value; };
+double func${index}_$i(Arg${index}_$i arg, int scale) { return arg.value * scale * 0.5; }
+int scoped${index}_$i(const std::string &text, long count)
+{
+    SENTRY
+    VALIDATE_ARGUMENT1(count, __FUNCTION__, -1);
+    SINFO(CE_Debug, 0, "%s %ld", text.c_str(), count);
+    return static_cast<int>(text.size() + count);
+    SLEAVE(-1)
+}
+EOF
+    done
+    echo "double file$index(int n)"
+    echo "{"
+    echo "    double total = 0;"
+    for ((i = 0; i < FUNCS; ++i)); do
+        echo "    total += SFUNC_RUN(func${index}_$i, Arg${index}_$i{n}, $i);"
+        echo "    auto decorated$i = SFUNC_DEC(func${index}_$i);"
+        echo "    total += decorated$i(Arg${index}_$i{n}, 2);"
+        echo "    total += scoped${index}_$i(\"call\", n);"
+    done
+    echo "    return total;"
+    echo "}"
+}
+
+now()
+{
+    date +%s%N
+}
+
+# Compiles the files of one header, prints the time in ms and the size of the objects and the program in KB
+build()
+{
+    local header=$1 dir=$WORK/$2 extra=$3
+    mkdir -p "$dir"
+    {
+        for ((f = 0; f < FILES; ++f)); do
+            echo "double file$f(int n);"
+        done
+        echo "int main(int argc, char *argv[]) { double total = 0;"
+        for ((f = 0; f < FILES; ++f)); do
+            echo "total += file$f(argc);"
+        done
+        echo "return total > 0 ? 0 : 1; }"
+    } >"$dir/main.cpp"
+    for ((f = 0; f < FILES; ++f)); do
+        generate "$header" $f >"$dir/file$f.cpp"
+    done
+    local start objects=0
+    start=$(now)
+    for ((f = 0; f < FILES; ++f)); do
+        $CXX -std=c++14 $CXXFLAGS -D_ENABLE_SLOG -I"$ROOT" -c "$dir/file$f.cpp" -o "$dir/file$f.o"
+        objects=$((objects + $(wc -c <"$dir/file$f.o")))
+    done
+    local elapsed=$((($(now) - start) / 1000000))
+    $CXX -std=c++14 $CXXFLAGS -c "$dir/main.cpp" -o "$dir/main.o"
+    $CXX "$dir"/*.o $extra -o "$dir/program" -pthread
+    echo "$elapsed $((objects / 1024)) $(($(wc -c <"$dir/program") / 1024))"
+}
+
+start=$(now)
+$CXX -std=c++14 $CXXFLAGS -D_ENABLE_SLOG -I"$ROOT" -c "$ROOT/slog.cpp" -o "$WORK/slog.o"
+library_ms=$((($(now) - start) / 1000000))
+library_kb=$(($(wc -c <"$WORK/slog.o") / 1024))
+
+read -r full_ms full_obj full_bin <<<"$(build slog.h full "")"
+read -r lite_ms lite_obj lite_bin <<<"$(build slog_lite.h lite "$WORK/slog.o")"
+
+echo "$FILES files, $FUNCS functions each, $CXX $CXXFLAGS"
+printf "%-16s %12s %14s %14s %14s\n" "header" "compile(ms)" "per file(ms)" "objects(KB)" "program(KB)"
+printf "%-16s %12d %14d %14d %14d\n" "slog.h" "$full_ms" $((full_ms / FILES)) "$full_obj" "$full_bin"
+printf "%-16s %12d %14d %14d %14d\n" "slog_lite.h" "$lite_ms" $((lite_ms / FILES)) "$lite_obj" "$lite_bin"
+printf "%-16s %12d %14s %14d %14s\n" "slog.cpp (once)" "$library_ms" "-" "$library_kb" "-"
@@ -0,0 +1,177 @@
+/*
+ @ brief:   Minimal micro-benchmark harness of slog_bench, no dependencies
+ */
+
+#ifndef _SLOG_BENCH_HARNESS_H_
+#define _SLOG_BENCH_HARNESS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace bench
+{
+    // Make the compiler believe value is used
+    template <typename T>
+    inline void doNotOptimize(const T &value)
+    {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#endif
+    }
+
+    // Body of a benchmark, runs the measured call iterations times
+    typedef std::function<void(uint64_t iterations)> Body;
+
+    struct Options
+    {
+        double min_time_ms = 50; // Every repetition runs at least this long
+        int repetitions = 3;     // The median is reported
+        std::string filter;      // Only cases whose name, mode or sink contains it
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::string mode;
+        std::string sink;
+        int threads;
+        uint64_t iterations; // Per thread and repetition
+        double ns_per_call;  // Median over the repetitions, seen by one thread
+        double min_ns;
+        double max_ns;
+        double calls_per_second; // All threads together
+    };
+
+    class Runner
+    {
+    private:
+        Options _options;
+        std::vector<Result> _results;
+
+        // Wall time of threads running body at once, in ns
+        static double measure(const Body &body, int threads, uint64_t iterations)
+        {
+            if (threads == 1)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                body(iterations);
+                return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            }
+            std::atomic<int> ready(0);
+            std::atomic<bool> go(false);
+            std::vector<std::thread> workers;
+            for (int i = 0; i < threads; ++i)
+            {
+                workers.emplace_back([&]()
+                                     {
+                    ready.fetch_add(1);
+                    while (!go.load())
+                        std::this_thread::yield();
+                    body(iterations); });
+            }
+            while (ready.load() != threads)
+                std::this_thread::yield();
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            go.store(true);
+            for (std::thread &worker : workers)
+                worker.join();
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    public:
+        explicit Runner(const Options &options)
+            : _options(options)
+        {
+        }
+
+        bool selected(const std::string &name, const std::string &mode, const std::string &sink) const
+        {
+            return _options.filter.empty() || name.find(_options.filter) != std::string::npos ||
+                   mode.find(_options.filter) != std::string::npos || sink.find(_options.filter) != std::string::npos;
+        }
+
+        // Grow the iterations until a run takes min_time_ms, then keep the median of the repetitions
+        void run(const std::string &name, const std::string &mode, const std::string &sink, int threads,
+                 const Body &body)
+        {
+            if (!selected(name, mode, sink))
+                return;
+            double target = _options.min_time_ms * 1e6;
+            uint64_t iterations = 1000;
+            double elapsed = measure(body, threads, iterations);
+            while (elapsed < target / 10)
+            {
+                iterations *= 10;
+                elapsed = measure(body, threads, iterations);
+            }
+            iterations = std::max<uint64_t>(1, static_cast<uint64_t>(iterations * target / elapsed));
+            std::vector<double> samples;
+            for (int i = 0; i < std::max(1, _options.repetitions); ++i)
+                samples.push_back(measure(body, threads, iterations) / iterations);
+            std::sort(samples.begin(), samples.end());
+            Result result;
+            result.name = name;
+            result.mode = mode;
+            result.sink = sink;
+            result.threads = threads;
+            result.iterations = iterations;
+            result.ns_per_call = samples[samples.size() / 2];
+            result.min_ns = samples.front();
+            result.max_ns = samples.back();
+            result.calls_per_second = threads * 1e9 / result.ns_per_call;
+            _results.push_back(result);
+            printf("%-16s %-14s %-8s %3d %12.1f ns %14.0f calls/s\n", name.c_str(), mode.c_str(), sink.c_str(),
+                   threads, result.ns_per_call, result.calls_per_second);
+            fflush(stdout);
+        }
+
+        const std::vector<Result> &results() const
+        {
+            return _results;
+        }
+
+        // Results with the context they were measured in, one object per result
+        void writeJson(FILE *file, const std::vector<std::pair<std::string, std::string>> &context) const
+        {
+            fprintf(file, "{\n  \"context\": {\n");
+            for (size_t i = 0; i < context.size(); ++i)
+            {
+                fprintf(file, "    \"%s\": \"%s\"%s\n", context[i].first.c_str(), context[i].second.c_str(),
+                        i + 1 < context.size() ? "," : "");
+            }
+            fprintf(file, "  },\n  \"benchmarks\": [\n");
+            for (size_t i = 0; i < _results.size(); ++i)
+            {
+                const Result &result = _results[i];
+                fprintf(file,
+                        "    {\"name\": \"%s\", \"mode\": \"%s\", \"sink\": \"%s\", \"threads\": %d, "
+                        "\"iterations\": %llu, \"ns_per_call\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f, "
+                        "\"calls_per_second\": %.0f}%s\n",
+                        result.name.c_str(), result.mode.c_str(), result.sink.c_str(), result.threads,
+                        static_cast<unsigned long long>(result.iterations), result.ns_per_call, result.min_ns,
+                        result.max_ns, result.calls_per_second, i + 1 < _results.size() ? "," : "");
+            }
+            fprintf(file, "  ]\n}\n");
+        }
+    };
+}
+
+#endif // _SLOG_BENCH_HARNESS_H_
@@ -0,0 +1,233 @@
+/*
+ @ brief:   Cost of the slog decorators per call, by sink, level and number of threads
+ @ usage:   slog_bench [--json file] [--threads max] [--min-time ms] [--repetitions n] [--filter text]
+ */
+
+#ifndef _ENABLE_SLOG
+#define _ENABLE_SLOG
+#endif
+
+#define SLOG_BENCH_CASES runEnabledCases
+#include "bench/cases.h"
+
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <vector>
+
+#ifndef SLOG_BENCH_BUILD_TYPE
+#define SLOG_BENCH_BUILD_TYPE "unknown"
+#endif
+
+#ifdef _WIN32
+#define SLOG_BENCH_NULL_DEVICE "NUL"
+#else
+#define SLOG_BENCH_NULL_DEVICE "/dev/null"
+#endif
+
+void runCompiledOutCases(bench::Runner &runner, const char *mode, const char *sink, int threads);
+
+namespace
+{
+    const char *kLogPath = "slog_bench.log";
+    const char *kPackedPath = "slog_bench.slz";
+    const char *kTracePath = "slog_bench.trace.json";
+    const char *kFlightPath = "slog_bench.flight";
+
+    // Back to synchronous text output on the default sink, every record written
+    void reset()
+    {
+        slog::shutdownAsync();
+        slog::setAggregate(false);
+        slog::setCounters({});
+        slog::setAllocationTracking(false);
+        slog::setProfile(false);
+        slog::closeFlightRecorder();
+        slog::closeSharedStats();
+        slog::setCapture(slog::CaptureStyle::None);
+        slog::clearSampling();
+        slog::clearSinks();
+        slog::addSink(slog::defaultSink());
+        slog::setLevel(CE_Debug);
+    }
+
+    void useSink(const std::shared_ptr<slog::Sink> &sink)
+    {
+        slog::clearSinks();
+        slog::addSink(sink);
+    }
+
+    BENCH_NOINLINE int checked(const std::vector<double> &values)
+    {
+        VALIDATE_ARGUMENT1(values, "checked", -1);
+        return 0;
+    }
+
+    // VALIDATE_ARGUMENT over 4 MiB of doubles with each kernel the CPU runs, the best one is left selected
+    void runValidation(bench::Runner &runner, int threads)
+    {
+        std::vector<double> values(1 << 19, 1.0);
+        for (int kernel = 0; slog::setValidationKernel(static_cast<slog::ValidationKernel>(kernel)); ++kernel)
+        {
+            runner.run("VALIDATE_ARG", slog::kernelName(static_cast<slog::ValidationKernel>(kernel)), "4MiB",
+                       threads, [&values](uint64_t n)
+                       {
+                for (uint64_t i = 0; i < n; ++i)
+                    bench::doNotOptimize(checked(values)); });
+        }
+    }
+
+    const char *compiler()
+    {
+#if defined(__clang__)
+        return "clang " __clang_version__;
+#elif defined(__GNUC__)
+        return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+        return "msvc";
+#else
+        return "unknown";
+#endif
+    }
+
+    // True in slog_bench_alloc, which links bench/alloc_hooks.cpp
+    bool allocationHooks()
+    {
+        bool hooked = slog::setAllocationTracking(true);
+        slog::setAllocationTracking(false);
+        return hooked;
+    }
+
+    // Every configuration for one thread count
+    // The allocation hooks run on every new and delete, so only slog_bench_alloc has them and it runs
+    // the "allocations" mode alone
+    void runAll(bench::Runner &runner, int threads)
+    {
+        reset();
+        if (allocationHooks())
+        {
+            slog::setAggregate(true);
+            slog::setAllocationTracking(true);
+            runEnabledCases(runner, "allocations", "none", threads);
+            return;
+        }
+
+        runEnabledCases(runner, "enabled", "stderr", threads);
+
+        useSink(std::make_shared<slog::FileSink>(kLogPath, false));
+        runEnabledCases(runner, "enabled", "file", threads);
+
+        useSink(std::make_shared<slog::CompressedFileSink>(kPackedPath, false));
+        runEnabledCases(runner, "enabled", "packed", threads);
+
+        useSink(std::make_shared<slog::MemorySink>());
+        runEnabledCases(runner, "enabled", "memory", threads);
+
+        slog::setCapture(slog::CaptureStyle::Logfmt);
+        runEnabledCases(runner, "capture", "memory", threads);
+
+        reset();
+        slog::startAsync(1 << 16, slog::OverflowPolicy::Block);
+        runEnabledCases(runner, "async", "stderr", threads);
+
+        reset();
+        slog::setSampling(slog::oneIn(1000));
+        runEnabledCases(runner, "sampled", "stderr", threads);
+
+        reset();
+        slog::setAggregate(true);
+        runEnabledCases(runner, "aggregate", "none", threads);
+
+        slog::setCounters({slog::Counter::Cycles, slog::Counter::Instructions});
+        runEnabledCases(runner, "counters", "none", threads);
+
+        reset();
+        slog::setLevel(CE_Failure);
+        slog::openTrace(kTracePath);
+        runEnabledCases(runner, "trace", "file", threads);
+        slog::closeTrace();
+
+        reset();
+        slog::setLevel(CE_Failure);
+        slog::setProfile(true);
+        runEnabledCases(runner, "profile", "none", threads);
+
+        reset();
+        slog::setLevel(CE_Failure);
+        slog::openFlightRecorder(kFlightPath);
+        runEnabledCases(runner, "flight", "mmap", threads);
+
+        reset();
+        slog::setLevel(CE_Failure);
+        slog::openSharedStats();
+        runEnabledCases(runner, "shared", "shm", threads);
+
+        reset();
+        slog::setLevel(CE_Failure);
+        runEnabledCases(runner, "filtered", "none", threads);
+
+        reset();
+        runCompiledOutCases(runner, "compiled_out", "none", threads);
+
+        runValidation(runner, threads);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::Options options;
+    const char *json_path = nullptr;
+    int max_threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int i = 1; i < argc; ++i)
+    {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--json") == 0 && has_value)
+            json_path = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && has_value)
+            max_threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--min-time") == 0 && has_value)
+            options.min_time_ms = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value)
+            options.repetitions = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--filter") == 0 && has_value)
+            options.filter = argv[++i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--json file] [--threads max] [--min-time ms] [--repetitions n] [--filter text]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+
+    // The stderr sink writes to the null device, only slog itself is measured
+    if (freopen(SLOG_BENCH_NULL_DEVICE, "w", stderr) == nullptr)
+        return 1;
+
+    bench::Runner runner(options);
+    printf("%-16s %-14s %-8s %3s %15s %21s\n", "case", "mode", "sink", "thr", "per call", "throughput");
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+        runAll(runner, threads);
+    reset();
+    std::remove(kLogPath);
+    std::remove(kPackedPath);
+    std::remove(kTracePath);
+    std::remove(kFlightPath);
+
+    if (json_path != nullptr)
+    {
+        FILE *file = fopen(json_path, "w");
+        if (file == nullptr)
+        {
+            printf("Can not open %s\n", json_path);
+            return 1;
+        }
+        char date[SLOG_TIME_BUFFER_SIZE];
+        slog::formatTime(date, sizeof(date));
+        runner.writeJson(file, {{"date", date},
+                                {"build_type", SLOG_BENCH_BUILD_TYPE},
+                                {"compiler", compiler()},
+                                {"hardware_concurrency", std::to_string(std::thread::hardware_concurrency())}});
+        fclose(file);
+    }
+    return 0;
+}
@@ -37,6 +37,42 @@ double get2(reals vec, int index)
     SLEAVE(std::numeric_limits<double>::quiet_NaN())
 };
 
+// Count copies and moves to show that decorating adds none
+struct Tracked
+{
+    static int copies;
+    static int moves;
+    Tracked() {}
+    Tracked(const Tracked &) { ++copies; }
+    Tracked(Tracked &&) { ++moves; }
+};
+int Tracked::copies = 0;
+int Tracked::moves = 0;
+
+Tracked pass(Tracked t)
+{
+    return t;
+}
+
+struct Passer
+{
+    Tracked pass(Tracked t)
+    {
+        return t;
+    }
+};
+
+// Copies and moves of a decorated call against the plain call, false when the decorator added any
+bool sameCounts(const char *name, int copies, int moves)
+{
+    printf("%s: copies = %d, moves = %d\n", name, Tracked::copies, Tracked::moves);
+    bool same = Tracked::copies == copies && Tracked::moves == moves;
+    if (!same)
+        printf("%s adds copies or moves, the plain call makes %d and %d\n", name, copies, moves);
+    Tracked::copies = Tracked::moves = 0;
+    return same;
+}
+
 void change(int *a, int b)
 {
     VALIDATE_ARGUMENT0(a, __FUNCTION__);
@@ -45,6 +81,17 @@ void change(int *a, int b)
     *a = b;
 };
 
+// Every element is checked, NaN and Inf are reported with their count and the first index
+double mean(const reals &vec)
+{
+    VALIDATE_ARGUMENT1(vec, __FUNCTION__, NaN<double>());
+
+    double sum = 0.0;
+    for (double value : vec)
+        sum += value;
+    return sum / vec.size();
+}
+
 int main(int argc, char *argv[])
 {
     reals vec = {1.52, 2.33, -3.14, 0.44, 90.18};
@@ -74,5 +121,23 @@ int main(int argc, char *argv[])
     double g = SACTION(rv.get(1, 3));
     printf("g = %g\n", g);
 
-    return 0;
-}
\ No newline at end of file
+    vec[3] = std::numeric_limits<double>::quiet_NaN();
+    double h = mean(vec);
+    printf("h = %g\n", h);
+
+    Tracked t;
+    pass(t);
+    int copies = Tracked::copies;
+    int moves = Tracked::moves;
+    bool same = sameCounts("plain", copies, moves);
+    SFUNC_RUN(pass, t);
+    same = sameCounts("SFUNC_RUN", copies, moves) && same;
+    auto new_pass = SFUNC_DEC(pass);
+    new_pass(t);
+    same = sameCounts("SFUNC_DEC", copies, moves) && same;
+    Passer passer;
+    SFUNC_MEM_RUN(passer, Passer::pass, t);
+    same = sameCounts("SFUNC_MEM_RUN", copies, moves) && same;
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include <iostream>
+#include <vector>
+#include "slog_lite.h"
+
+// The same calls as sample.cpp through the front-end header, linked against the slog library
+
+using reals = std::vector<double>;
+
+double get(reals vec, int index)
+{
+    return vec.at(index);
+}
+
+class RealVec
+{
+private:
+    reals _vec;
+
+public:
+    RealVec() {}
+    void init(reals vec)
+    {
+        _vec = vec;
+    }
+    double get(int index, int add)
+    {
+        return _vec.at(index + add);
+    }
+};
+
+double get2(reals vec, int index)
+{
+    SENTRY
+
+    return vec.at(index);
+
+    SLEAVE(std::numeric_limits<double>::quiet_NaN())
+};
+
+void change(int *a, int b)
+{
+    VALIDATE_ARGUMENT0(a, __FUNCTION__);
+    VALIDATE_ARGUMENT0(b, __FUNCTION__);
+
+    *a = b;
+};
+
+int main(int argc, char *argv[])
+{
+    reals vec = {1.52, 2.33, -3.14, 0.44, 90.18};
+    double a = SFUNC_RUN(get, vec, 2);
+    printf("a = %g\n", a);
+
+    auto new_get = SFUNC_DEC(get);
+    double b = new_get(vec, 20);
+    printf("b = %g\n", b);
+
+    RealVec rv;
+    SFUNC_MEM_RUN(rv, RealVec::init, vec);
+    double c = SFUNC_MEM_RUN(rv, RealVec::get, 3, 4);
+    printf("c = %g\n", c);
+
+    double d = get2(vec, 1);
+    printf("d = %g\n", d);
+
+    int e = 0;
+    change(nullptr, 1);
+    change(&e, 2);
+    SINFO(CE_Warning, CPLE_AppDefined, "e = %d, %s", e, "done");
+
+    double f = SACTION(rv.get(1, 3));
+    printf("f = %g\n", f);
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ @ brief:   The slog library behind slog_lite.h
+            Sinks, formatting and time code are compiled here once, slog.h configures them as before
+ */
+
+#include <cstdarg>
+#include <new>
+#include <string>
+#include "slog.h"
+#include "slog_lite.h"
+
+namespace
+{
+    // The slog::CallSite of a front-end site, made once and kept for the whole program
+    const slog::CallSite &callSite(const slog::lite::Site &site)
+    {
+        void *impl = site.impl.load(std::memory_order_acquire);
+        if (impl == nullptr)
+        {
+            slog::CallSite *fresh = new slog::CallSite{site.func_name, site.file_name, site.args_name, site.line_no};
+            if (site.impl.compare_exchange_strong(impl, fresh, std::memory_order_acq_rel))
+                impl = fresh;
+            else
+                delete fresh;
+        }
+        return *static_cast<const slog::CallSite *>(impl);
+    }
+
+    slog::EntryScope &entryScope(unsigned char *state)
+    {
+        return *reinterpret_cast<slog::EntryScope *>(state);
+    }
+}
+
+namespace slog
+{
+    namespace lite
+    {
+        bool shouldLog(CPLErr level)
+        {
+            return slog::shouldLog(level);
+        }
+
+        bool shouldRecord(CPLErr level)
+        {
+            return slog::shouldLog(level) || slog::flightMap(level) != nullptr;
+        }
+
+        void info(CPLErr level, int err_no, const char *format, ...)
+        {
+            char buffer[1024];
+            std::string text;
+            va_list args;
+            va_start(args, format);
+            int len = vsnprintf(buffer, sizeof(buffer), format, args);
+            va_end(args);
+            if (len < 0)
+                return;
+            const char *message = buffer;
+            if (static_cast<size_t>(len) >= sizeof(buffer))
+            {
+                text.resize(static_cast<size_t>(len) + 1);
+                va_start(args, format);
+                vsnprintf(&text[0], text.size(), format, args);
+                va_end(args);
+                message = text.c_str();
+            }
+            SINFO(level, err_no, "%s", message);
+        }
+
+        void logAction(const Site &site)
+        {
+            actLog(callSite(site));
+        }
+
+        void invalid(const Site &site, const char *arg_name)
+        {
+            reportFailure(callSite(site), EventKind::Action, false, EventKind::Invalid, arg_name);
+        }
+
+        void invalid(const Site &site, const char *arg_name, const Validation &validation)
+        {
+            reportInvalid(callSite(site), arg_name, slog::Validation{validation.invalid, validation.first, validation.size});
+        }
+
+        Validation validateRange(const float *data, size_t size)
+        {
+            slog::Validation result = slog::validate(slog::span(data, size));
+            return Validation{result.invalid, result.first, result.size};
+        }
+
+        Validation validateRange(const double *data, size_t size)
+        {
+            slog::Validation result = slog::validate(slog::span(data, size));
+            return Validation{result.invalid, result.first, result.size};
+        }
+
+        static_assert(sizeof(EntryScope) <= SLOG_LITE_SCOPE_SIZE, "SLOG_LITE_SCOPE_SIZE is too small");
+        static_assert(alignof(EntryScope) <= 16, "slog::lite::Scope is not aligned enough");
+
+        Scope::Scope(const Site &site, Kind kind)
+        {
+            new (_state) EntryScope(callSite(site), kind == Call ? EventKind::Call : EventKind::Action);
+        }
+
+        Scope::~Scope()
+        {
+            entryScope(_state).~EntryScope();
+        }
+
+        void Scope::fail(const char *message)
+        {
+            entryScope(_state).fail(EventKind::Failure, message);
+        }
+
+        void Scope::fatal()
+        {
+            entryScope(_state).fail(EventKind::Fatal);
+        }
+    }
+}
@@ -13,599 +13,7530 @@
 #include <iostream>
 #include <string>
 #include <functional>
+#include <future>
 #include <ctime>
 #include <chrono>
 #include <iomanip>
 #include <cassert>
 #include <type_traits>
 #include <utility>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cmath>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <malloc.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <malloc.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#endif
+
+#ifdef SLOG_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef CPL_ERROR_H_INCLUDED // Use CPLError
+
+#include <cpl_error.h>
+
+#elif !defined(SLOG_CPL_ERROR_DEFINED) // Use custom error, shared with slog_lite.h
+#define SLOG_CPL_ERROR_DEFINED
+
+typedef enum
+{
+    CE_None = 0,
+    CE_Debug = 1,
+    CE_Warning = 2,
+    CE_Failure = 3,
+    CE_Fatal = 4
+} CPLErr;
+
+typedef enum
+{
+    CPLE_None,
+    CPLE_AppDefined,
+    CPLE_OutOfMemory,
+    CPLE_FileIO,
+    CPLE_OpenFailed,
+    CPLE_IllegalArg,
+    CPLE_NotSupported,
+    CPLE_AssertionFailed,
+    CPLE_NoWriteAccess,
+    CPLE_UserInterrupt,
+    CPLE_ObjectNull,
+    CPLE_HttpResponse,
+    CPLE_AWSBucketNotFound,
+    CPLE_AWSObjectNotFound,
+    CPLE_AWSAccessDenied,
+    CPLE_AWSInvalidCredentials,
+    CPLE_AWSSignatureDoesNotMatch,
+} CPLErrorNum;
+
+#endif // CPL_ERROR_H_INCLUDED
+
+namespace slog
+{
+    namespace detail
+    {
+        // Serializes all output, one instance for the whole program since inline functions share their statics
+        inline std::mutex &outputMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+    }
+}
+
+#define SLOCK slog::detail::outputMutex().lock()
+#define SUNLOCK slog::detail::outputMutex().unlock()
+
+#ifndef SLOG_ASYNC_PAYLOAD_SIZE
+#define SLOG_ASYNC_PAYLOAD_SIZE 224 // Bytes of packed SINFO arguments in one async record
+#endif
+
+#ifndef SLOG_ASYNC_BATCH_SIZE
+#define SLOG_ASYNC_BATCH_SIZE 65536 // Bytes written by the consumer thread at once
+#endif
+
+#ifndef SLOG_FILE_BUFFER_SIZE
+#define SLOG_FILE_BUFFER_SIZE (1 << 20) // Bytes a file sink collects before writing them at once
+#endif
+
+#ifndef SLOG_FUTURE_POLL_US
+#define SLOG_FUTURE_POLL_US 100 // Longest wait before a ready future of a timed call is seen
+#endif
+
+#ifndef SLOG_BLOCK_SIZE
+#define SLOG_BLOCK_SIZE (1 << 17) // Bytes of text in one compressed block
+#endif
+
+#ifndef SLOG_BLOCK_QUEUE
+#define SLOG_BLOCK_QUEUE 8 // Full blocks waiting for the compressor before the open block grows
+#endif
+
+#define SLOG_BLOCK_MAGIC "SLOGBLK1"
+#define SLOG_BLOCK_VERSION 1
+#define SLOG_BLOCK_ORDER 0x01020304 // Headers are written in native byte order
+#define SLOG_BLOCK_TAG 0x6b6c4253 // Starts every block, "SBlk" in little endian
+
+// Format string of SINFO as a type, the literal stays reachable at compile time through a local class
+#define SLOG_FORMAT(str)                        \
+    ([] {                                       \
+        struct SlogFormat                       \
+        {                                       \
+            static constexpr const char *text() \
+            {                                   \
+                return str;                     \
+            }                                   \
+        };                                      \
+        return SlogFormat();                    \
+    }())
+
+#define SLOG_EXPAND(x) x
+#define SLOG_FIRST_(first, ...) first
+#define SLOG_FIRST(...) SLOG_EXPAND(SLOG_FIRST_(__VA_ARGS__, 0))
+
+namespace slog
+{
+    namespace detail
+    {
+        // What a conversion accepts and what an argument is
+        enum class ArgClass : uint8_t
+        {
+            None,
+            Int,
+            Float,
+            String,
+            Pointer
+        };
+
+        enum FormatFlag : uint8_t
+        {
+            FlagLeft = 1,
+            FlagZero = 2,
+            FlagPlus = 4,
+            FlagSpace = 8,
+            FlagAlt = 16
+        };
+
+        // One conversion and the text before it, conversion is 0 for the text after the last one
+        struct FormatSpec
+        {
+            uint32_t literal; // Offset of the text in the format string
+            uint32_t literal_size;
+            char conversion;
+            uint8_t flags;
+            int32_t width;     // -1 when absent, -2 when taken from the arguments
+            int32_t precision; // -1 when absent, -2 when taken from the arguments
+        };
+
+        template <size_t N>
+        struct FormatPlan
+        {
+            FormatSpec specs[N];
+            bool valid;
+        };
+
+        constexpr uint8_t formatFlag(char c)
+        {
+            return c == '-'   ? FlagLeft
+                   : c == '0' ? FlagZero
+                   : c == '+' ? FlagPlus
+                   : c == ' ' ? FlagSpace
+                   : c == '#' ? FlagAlt
+                              : 0;
+        }
+
+        constexpr bool isLengthModifier(char c)
+        {
+            return c == 'h' || c == 'l' || c == 'L' || c == 'q' || c == 'j' || c == 'z' || c == 't';
+        }
+
+        constexpr ArgClass conversionClass(char c)
+        {
+            switch (c)
+            {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            case 'c':
+                return ArgClass::Int;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                return ArgClass::Float;
+            case 's':
+                return ArgClass::String;
+            case 'p':
+                return ArgClass::Pointer;
+            default:
+                return ArgClass::None;
+            }
+        }
+
+        // Conversions including %%, plus the text after the last one
+        constexpr size_t countSpecs(const char *fmt)
+        {
+            size_t count = 1;
+            for (size_t i = 0; fmt[i] != '\0'; ++i)
+            {
+                if (fmt[i] != '%')
+                    continue;
+                ++count;
+                if (fmt[i + 1] == '\0')
+                    break;
+                ++i;
+            }
+            return count;
+        }
+
+        constexpr int32_t parseNumber(const char *fmt, size_t &i)
+        {
+            int32_t value = 0;
+            while (fmt[i] >= '0' && fmt[i] <= '9')
+                value = value * 10 + (fmt[i++] - '0');
+            return value;
+        }
+
+        // Split a format string into its conversions once, at compile time
+        template <size_t N>
+        constexpr FormatPlan<N> parseFormat(const char *fmt)
+        {
+            FormatPlan<N> plan = {};
+            size_t count = 0;
+            size_t literal = 0;
+            size_t i = 0;
+            for (;;)
+            {
+                if (fmt[i] != '%' && fmt[i] != '\0')
+                {
+                    ++i;
+                    continue;
+                }
+                if (count == N)
+                    return plan;
+                FormatSpec &spec = plan.specs[count++];
+                spec.literal = static_cast<uint32_t>(literal);
+                spec.literal_size = static_cast<uint32_t>(i - literal);
+                spec.width = -1;
+                spec.precision = -1;
+                if (fmt[i] == '\0')
+                    break;
+                ++i;
+                while (formatFlag(fmt[i]) != 0)
+                    spec.flags |= formatFlag(fmt[i++]);
+                if (fmt[i] == '*')
+                {
+                    spec.width = -2;
+                    ++i;
+                }
+                else if (fmt[i] >= '0' && fmt[i] <= '9')
+                    spec.width = parseNumber(fmt, i);
+                if (fmt[i] == '.')
+                {
+                    ++i;
+                    if (fmt[i] == '*')
+                    {
+                        spec.precision = -2;
+                        ++i;
+                    }
+                    else
+                        spec.precision = parseNumber(fmt, i);
+                }
+                while (isLengthModifier(fmt[i]))
+                    ++i;
+                if (fmt[i] != '%' && conversionClass(fmt[i]) == ArgClass::None)
+                    return plan;
+                spec.conversion = fmt[i++];
+                literal = i;
+            }
+            plan.valid = count == N;
+            return plan;
+        }
+
+        template <typename T>
+        constexpr ArgClass argClass()
+        {
+            return std::is_integral<T>::value || std::is_enum<T>::value ? ArgClass::Int
+                   : std::is_floating_point<T>::value                  ? ArgClass::Float
+                   : std::is_same<T, const char *>::value || std::is_same<T, char *>::value
+                       ? ArgClass::String
+                   : std::is_pointer<T>::value || std::is_same<T, std::nullptr_t>::value ? ArgClass::Pointer
+                                                                                         : ArgClass::None;
+        }
+
+        constexpr bool accepts(char conversion, ArgClass arg)
+        {
+            return conversionClass(conversion) == arg ||
+                   (conversionClass(conversion) == ArgClass::Pointer && arg == ArgClass::String);
+        }
+
+        // Every conversion has an argument of its kind and no argument is left over
+        template <size_t N, typename... ARGS>
+        constexpr bool matchFormat(const FormatPlan<N> &plan)
+        {
+            const ArgClass args[] = {argClass<ARGS>()..., ArgClass::None};
+            size_t next = 0;
+            if (!plan.valid)
+                return false;
+            for (size_t i = 0; i + 1 < N; ++i)
+            {
+                const FormatSpec &spec = plan.specs[i];
+                if (spec.conversion == '%')
+                    continue;
+                if (spec.width == -2 && (next >= sizeof...(ARGS) || args[next++] != ArgClass::Int))
+                    return false;
+                if (spec.precision == -2 && (next >= sizeof...(ARGS) || args[next++] != ArgClass::Int))
+                    return false;
+                if (next >= sizeof...(ARGS) || !accepts(spec.conversion, args[next++]))
+                    return false;
+            }
+            return next == sizeof...(ARGS);
+        }
+
+        template <typename FMT>
+        struct CompiledFormat
+        {
+            static constexpr size_t count = countSpecs(FMT::text());
+            static constexpr FormatPlan<count> plan = parseFormat<count>(FMT::text());
+        };
+
+        template <typename FMT>
+        constexpr size_t CompiledFormat<FMT>::count;
+
+        template <typename FMT>
+        constexpr FormatPlan<CompiledFormat<FMT>::count> CompiledFormat<FMT>::plan;
+
+        // One argument with its type erased, the conversion was checked against it already
+        struct FormatArg
+        {
+            ArgClass kind;
+            bool is_signed;
+            uint8_t size;
+            union
+            {
+                int64_t i;
+                uint64_t u;
+                double f;
+                const char *s;
+                const void *p;
+            };
+
+            FormatArg()
+                : kind(ArgClass::None),
+                  is_signed(false),
+                  size(0),
+                  u(0)
+            {
+            }
+        };
+
+        template <typename T, ArgClass C>
+        struct FormatArgOf
+        {
+            static FormatArg make(const T &)
+            {
+                return FormatArg();
+            }
+        };
+
+        template <typename T>
+        struct FormatArgOf<T, ArgClass::Int>
+        {
+            static FormatArg make(T value)
+            {
+                FormatArg arg;
+                arg.kind = ArgClass::Int;
+                arg.is_signed = std::is_enum<T>::value || std::is_signed<T>::value;
+                arg.size = sizeof(T);
+                if (arg.is_signed)
+                    arg.i = static_cast<int64_t>(value);
+                else
+                    arg.u = static_cast<uint64_t>(value);
+                return arg;
+            }
+        };
+
+        template <typename T>
+        struct FormatArgOf<T, ArgClass::Float>
+        {
+            static FormatArg make(T value)
+            {
+                FormatArg arg;
+                arg.kind = ArgClass::Float;
+                arg.f = static_cast<double>(value);
+                return arg;
+            }
+        };
+
+        template <typename T>
+        struct FormatArgOf<T, ArgClass::String>
+        {
+            static FormatArg make(const char *value)
+            {
+                FormatArg arg;
+                arg.kind = ArgClass::String;
+                arg.s = value;
+                return arg;
+            }
+        };
+
+        template <typename T>
+        struct FormatArgOf<T, ArgClass::Pointer>
+        {
+            static FormatArg make(T value)
+            {
+                FormatArg arg;
+                arg.kind = ArgClass::Pointer;
+                arg.p = value;
+                return arg;
+            }
+        };
+
+        template <typename T>
+        FormatArg formatArg(const T &value)
+        {
+            return FormatArgOf<std::decay_t<T>, argClass<std::decay_t<T>>()>::make(value);
+        }
+
+        // Counts like snprintf what does not fit
+        struct FormatOutput
+        {
+            char *out;
+            size_t size;
+            size_t len;
+
+            void put(const char *text, size_t n)
+            {
+                if (n != 0 && len < size)
+                    std::memcpy(out + len, text, std::min(n, size - len));
+                len += n;
+            }
+
+            void fill(char c, size_t n)
+            {
+                if (len < size)
+                    std::memset(out + len, c, std::min(n, size - len));
+                len += n;
+            }
+
+            // Prefix, leading zeros and body, padded to width as the flags say
+            void pad(const FormatSpec &spec, const char *prefix, size_t prefix_size, size_t zeros, const char *body,
+                     size_t body_size, bool zero_pad)
+            {
+                size_t total = prefix_size + zeros + body_size;
+                size_t width = spec.width > 0 ? static_cast<size_t>(spec.width) : 0;
+                size_t gap = width > total ? width - total : 0;
+                if (gap > 0 && !(spec.flags & FlagLeft) && !zero_pad)
+                    fill(' ', gap);
+                put(prefix, prefix_size);
+                fill('0', zeros + (zero_pad && !(spec.flags & FlagLeft) ? gap : 0));
+                put(body, body_size);
+                if (gap > 0 && (spec.flags & FlagLeft))
+                    fill(' ', gap);
+            }
+        };
+
+        // Digits of value ending at end, returns where they start
+        inline char *writeDecimal(char *end, uint64_t value)
+        {
+            static const char pairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                        "8081828384858687888990919293949596979899";
+            while (value >= 100)
+            {
+                size_t pair = static_cast<size_t>(value % 100) * 2;
+                value /= 100;
+                *--end = pairs[pair + 1];
+                *--end = pairs[pair];
+            }
+            if (value >= 10)
+            {
+                size_t pair = static_cast<size_t>(value) * 2;
+                *--end = pairs[pair + 1];
+                *--end = pairs[pair];
+            }
+            else
+                *--end = static_cast<char>('0' + value);
+            return end;
+        }
+
+        inline void formatInteger(FormatOutput &output, const FormatSpec &spec, const FormatArg &arg)
+        {
+            char c = spec.conversion;
+            if (c == 'c')
+            {
+                char ch = static_cast<char>(arg.i);
+                output.pad(spec, nullptr, 0, 0, &ch, 1, false);
+                return;
+            }
+            bool negative = false;
+            uint64_t value = arg.u;
+            if (c == 'd' || c == 'i')
+            {
+                negative = arg.is_signed && arg.i < 0;
+                if (negative)
+                    value = 0 - arg.u;
+            }
+            else if (arg.is_signed && arg.size < sizeof(uint64_t))
+                value &= (uint64_t(1) << (arg.size * 8)) - 1; // As printf sees a negative int
+            char digits[24];
+            char *end = digits + sizeof(digits);
+            char *begin = end;
+            if (value != 0 || spec.precision != 0)
+            {
+                if (c == 'x' || c == 'X')
+                {
+                    const char *hex = c == 'x' ? "0123456789abcdef" : "0123456789ABCDEF";
+                    for (uint64_t rest = value; begin == end || rest != 0; rest >>= 4)
+                        *--begin = hex[rest & 15];
+                }
+                else if (c == 'o')
+                {
+                    for (uint64_t rest = value; begin == end || rest != 0; rest >>= 3)
+                        *--begin = static_cast<char>('0' + (rest & 7));
+                }
+                else
+                    begin = writeDecimal(end, value);
+            }
+            size_t size = static_cast<size_t>(end - begin);
+            size_t zeros = spec.precision > 0 && static_cast<size_t>(spec.precision) > size
+                               ? static_cast<size_t>(spec.precision) - size
+                               : 0;
+            if (c == 'o' && (spec.flags & FlagAlt) && zeros == 0 && (size == 0 || *begin != '0'))
+                zeros = 1;
+            char prefix[2];
+            size_t prefix_size = 0;
+            if (negative)
+                prefix[prefix_size++] = '-';
+            else if ((c == 'd' || c == 'i') && (spec.flags & FlagPlus))
+                prefix[prefix_size++] = '+';
+            else if ((c == 'd' || c == 'i') && (spec.flags & FlagSpace))
+                prefix[prefix_size++] = ' ';
+            else if ((c == 'x' || c == 'X') && (spec.flags & FlagAlt) && value != 0)
+            {
+                prefix[prefix_size++] = '0';
+                prefix[prefix_size++] = c;
+            }
+            output.pad(spec, prefix, prefix_size, zeros, begin, size, (spec.flags & FlagZero) && spec.precision < 0);
+        }
+
+        inline void formatString(FormatOutput &output, const FormatSpec &spec, const char *text)
+        {
+            if (text == nullptr)
+                text = "(null)";
+            size_t size = 0;
+            if (spec.precision < 0)
+                size = std::strlen(text);
+            while (spec.precision >= 0 && size < static_cast<size_t>(spec.precision) && text[size] != '\0')
+                ++size;
+            output.pad(spec, nullptr, 0, 0, text, size, false);
+        }
+
+        // %f with up to 9 decimals from integers, false when only printf rounds it right
+        inline bool formatFixed(FormatOutput &output, const FormatSpec &spec, double value)
+        {
+            static const double scales[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+            static const uint64_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+                                              1000000000};
+            int precision = spec.precision < 0 ? 6 : spec.precision;
+            if (precision > 9 || (spec.flags & FlagAlt) || !std::isfinite(value))
+                return false;
+            // Below 4e12 an ulp of scaled is under 0.001, so only values this close to a tie are in doubt
+            double scaled = std::fabs(value) * scales[precision];
+            if (!(scaled < 4e12))
+                return false;
+            double whole = std::floor(scaled);
+            double fraction = scaled - whole;
+            if (fraction > 0.499 && fraction < 0.501)
+                return false;
+            uint64_t digits = static_cast<uint64_t>(whole) + (fraction > 0.5 ? 1 : 0);
+            char text[32];
+            char *end = text + sizeof(text);
+            char *begin = end;
+            if (precision > 0)
+            {
+                uint64_t decimals = digits % powers[precision];
+                for (int i = 0; i < precision; ++i, decimals /= 10)
+                    *--begin = static_cast<char>('0' + decimals % 10);
+                *--begin = '.';
+            }
+            begin = writeDecimal(begin, digits / powers[precision]);
+            char sign = std::signbit(value) ? '-' : (spec.flags & FlagPlus) ? '+' : (spec.flags & FlagSpace) ? ' ' : 0;
+            output.pad(spec, &sign, sign != 0 ? 1 : 0, 0, begin, static_cast<size_t>(end - begin),
+                       (spec.flags & FlagZero) != 0);
+            return true;
+        }
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+        // The conversions without a kernel of their own go to snprintf one at a time
+        inline void formatFallback(FormatOutput &output, const FormatSpec &spec, const FormatArg &arg)
+        {
+            char fmt[16];
+            size_t n = 0;
+            fmt[n++] = '%';
+            const char flags[] = "-0+ #";
+            for (int i = 0; i < 5; ++i)
+            {
+                if (spec.flags & (1 << i))
+                    fmt[n++] = flags[i];
+            }
+            fmt[n++] = '*';
+            if (arg.kind == ArgClass::Float)
+            {
+                fmt[n++] = '.';
+                fmt[n++] = '*';
+            }
+            fmt[n++] = spec.conversion;
+            fmt[n] = '\0';
+            char *out = output.len < output.size ? output.out + output.len : nullptr;
+            size_t room = output.len < output.size ? output.size - output.len : 0;
+            int width = spec.width > 0 ? spec.width : 0;
+            int done = arg.kind == ArgClass::Float ? std::snprintf(out, room, fmt, width, spec.precision, arg.f)
+                                                   : std::snprintf(out, room, fmt, width,
+                                                                   arg.kind == ArgClass::String ? arg.s : arg.p);
+            output.len += done > 0 ? static_cast<size_t>(done) : 0;
+        }
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+        inline int32_t argInt(const FormatArg &arg)
+        {
+            return arg.is_signed ? static_cast<int32_t>(arg.i) : static_cast<int32_t>(arg.u);
+        }
+
+        // Walk a parsed format, no format string is scanned at runtime
+        inline int renderFormat(char *out, size_t size, const char *text, const FormatSpec *specs, size_t count,
+                                const FormatArg *args)
+        {
+            FormatOutput output = {out, size, 0};
+            for (size_t i = 0; i < count; ++i)
+            {
+                FormatSpec spec = specs[i];
+                output.put(text + spec.literal, spec.literal_size);
+                if (spec.conversion == 0)
+                    break;
+                if (spec.conversion == '%')
+                {
+                    output.put("%", 1);
+                    continue;
+                }
+                if (spec.width == -2)
+                {
+                    spec.width = argInt(*args++);
+                    if (spec.width < 0)
+                    {
+                        spec.flags |= FlagLeft;
+                        spec.width = -spec.width;
+                    }
+                }
+                if (spec.precision == -2)
+                    spec.precision = std::max(-1, argInt(*args++));
+                const FormatArg &arg = *args++;
+                switch (spec.conversion)
+                {
+                case 's':
+                    formatString(output, spec, arg.s);
+                    break;
+                case 'f':
+                case 'F':
+                    if (!formatFixed(output, spec, arg.f))
+                        formatFallback(output, spec, arg);
+                    break;
+                case 'p':
+                case 'e':
+                case 'E':
+                case 'g':
+                case 'G':
+                case 'a':
+                case 'A':
+                    formatFallback(output, spec, arg);
+                    break;
+                default:
+                    formatInteger(output, spec, arg);
+                    break;
+                }
+            }
+            if (size > 0)
+                out[std::min(output.len, size - 1)] = '\0';
+            return static_cast<int>(output.len);
+        }
+
+        // snprintf with a format checked and split at compile time
+        template <typename FMT, typename... ARGS>
+        int formatTo(char *out, size_t size, FMT, const ARGS &...args)
+        {
+            typedef CompiledFormat<FMT> Compiled;
+            static_assert(matchFormat<Compiled::count, std::decay_t<ARGS>...>(Compiled::plan),
+                          "slog format string does not match its arguments");
+            const FormatArg packed[] = {formatArg(args)..., FormatArg()};
+            return renderFormat(out, size, FMT::text(), Compiled::plan.specs, Compiled::count, packed);
+        }
+    }
+}
+
+namespace slog
+{
+    // Destination of formatted records
+    // Sinks are called with the output lock held and need no locking of their own
+    class Sink
+    {
+    public:
+        virtual ~Sink() {}
+        // One record of one or more lines, text ends with '\n'
+        virtual void write(CPLErr level, int err_no, const char *text, size_t size) = 0;
+        // End of a batch, after every record when synchronous and after every drained batch when asynchronous
+        virtual void commit() {}
+        // Hand everything buffered to the system, on slog::flush and before exit on CE_Fatal
+        virtual void flush() {}
+    };
+
+    // Standard error, one write per batch
+    class StderrSink : public Sink
+    {
+    private:
+        std::vector<char> _buffer;
+
+    public:
+        void write(CPLErr /* level */, int /* err_no */, const char *text, size_t size) override
+        {
+            _buffer.insert(_buffer.end(), text, text + size);
+            if (_buffer.size() >= SLOG_ASYNC_BATCH_SIZE)
+                commit();
+        }
+        void commit() override
+        {
+            if (_buffer.empty())
+                return;
+            fwrite(_buffer.data(), 1, _buffer.size(), stderr);
+            fflush(stderr);
+            _buffer.clear();
+        }
+        void flush() override
+        {
+            commit();
+        }
+    };
+
+#ifdef CPL_ERROR_H_INCLUDED
+    // GDAL error handler, one CPLError call per record
+    class CplErrorSink : public Sink
+    {
+    public:
+        void write(CPLErr level, int err_no, const char *text, size_t size) override
+        {
+            CPLError(level, err_no, "%.*s", static_cast<int>(size - 1), text);
+        }
+    };
+#endif
+
+    namespace detail
+    {
+        inline int openFile(const char *path, bool append)
+        {
+#ifdef _WIN32
+            return _open(path, _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC),
+                         _S_IREAD | _S_IWRITE);
+#else
+            return ::open(path, O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC), 0644);
+#endif
+        }
+
+        inline uint64_t fileSize(int fd)
+        {
+#ifdef _WIN32
+            long long size = _lseeki64(fd, 0, SEEK_END);
+#else
+            off_t size = ::lseek(fd, 0, SEEK_END);
+#endif
+            return size > 0 ? static_cast<uint64_t>(size) : 0;
+        }
+
+        // Retries short and interrupted writes, false when the file takes no more
+        inline bool writeFile(int fd, const char *data, size_t size)
+        {
+            while (size > 0)
+            {
+#ifdef _WIN32
+                int done = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(size, 1 << 30)));
+#else
+                ssize_t done = ::write(fd, data, size);
+                if (done < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (done <= 0)
+                    return false;
+                data += done;
+                size -= static_cast<size_t>(done);
+            }
+            return true;
+        }
+
+        inline void closeFile(int fd)
+        {
+#ifdef _WIN32
+            _close(fd);
+#else
+            ::close(fd);
+#endif
+        }
+    }
+
+    // File written with write(2) once buffer_size bytes are collected
+    class FileSink : public Sink
+    {
+    protected:
+        std::string _path;
+        int _fd;
+        std::unique_ptr<char[]> _buffer;
+        size_t _capacity;
+        size_t _used;
+        uint64_t _size; // Bytes of the current file, buffered ones included
+
+        void drain()
+        {
+            if (_used > 0 && _fd >= 0)
+                detail::writeFile(_fd, _buffer.get(), _used);
+            _used = 0;
+        }
+
+        void reopen(bool append)
+        {
+            drain();
+            if (_fd >= 0)
+                detail::closeFile(_fd);
+            _fd = detail::openFile(_path.c_str(), append);
+            _size = (append && _fd >= 0) ? detail::fileSize(_fd) : 0;
+        }
+
+    public:
+        explicit FileSink(const char *path, bool append = true, size_t buffer_size = SLOG_FILE_BUFFER_SIZE)
+            : _path(path),
+              _fd(-1),
+              _buffer(new char[buffer_size]),
+              _capacity(buffer_size),
+              _used(0),
+              _size(0)
+        {
+            reopen(append);
+        }
+        ~FileSink()
+        {
+            drain();
+            if (_fd >= 0)
+                detail::closeFile(_fd);
+        }
+        FileSink(const FileSink &) = delete;
+        FileSink &operator=(const FileSink &) = delete;
+
+        bool isOpen() const
+        {
+            return _fd >= 0;
+        }
+
+        void write(CPLErr /* level */, int /* err_no */, const char *text, size_t size) override
+        {
+            if (_fd < 0)
+                return;
+            if (_used + size > _capacity)
+                drain();
+            if (size > _capacity)
+                detail::writeFile(_fd, text, size);
+            else
+            {
+                std::memcpy(_buffer.get() + _used, text, size);
+                _used += size;
+            }
+            _size += size;
+        }
+        void flush() override
+        {
+            drain();
+        }
+    };
+
+    // File sink starting a new file past max_bytes or every interval
+    // path becomes path.1, path.1 becomes path.2 and so on, max_files old files are kept
+    class RotatingFileSink : public FileSink
+    {
+    private:
+        uint64_t _max_bytes;            // 0 for no size limit
+        std::chrono::seconds _interval; // 0 for no time limit
+        size_t _max_files;
+        std::chrono::steady_clock::time_point _next;
+
+        void rotate()
+        {
+            drain();
+            if (_fd >= 0)
+                detail::closeFile(_fd);
+            _fd = -1;
+            for (size_t i = _max_files; i > 0; --i)
+            {
+                std::string from = i == 1 ? _path : _path + "." + std::to_string(i - 1);
+                std::string to = _path + "." + std::to_string(i);
+                std::remove(to.c_str());
+                std::rename(from.c_str(), to.c_str());
+            }
+            reopen(false);
+            _next = std::chrono::steady_clock::now() + _interval;
+        }
+
+    public:
+        RotatingFileSink(const char *path, uint64_t max_bytes,
+                         std::chrono::seconds interval = std::chrono::seconds(0), size_t max_files = 5,
+                         size_t buffer_size = SLOG_FILE_BUFFER_SIZE)
+            : FileSink(path, true, buffer_size),
+              _max_bytes(max_bytes),
+              _interval(interval),
+              _max_files(max_files),
+              _next(std::chrono::steady_clock::now() + interval)
+        {
+        }
+
+        void write(CPLErr level, int err_no, const char *text, size_t size) override
+        {
+            if ((_max_bytes > 0 && _size > 0 && _size + size > _max_bytes) ||
+                (_interval.count() > 0 && std::chrono::steady_clock::now() >= _next))
+                rotate();
+            FileSink::write(level, err_no, text, size);
+        }
+    };
+
+    // How the blocks of a CompressedFileSink are packed
+    enum class BlockCodec : uint8_t
+    {
+        Stored, // Kept as is when packing does not make it smaller
+        Lz,     // Built-in codec, the LZ4 block format
+        Zlib    // Only with SLOG_USE_ZLIB
+    };
+
+    inline BlockCodec defaultCodec()
+    {
+#ifdef SLOG_USE_ZLIB
+        return BlockCodec::Zlib;
+#else
+        return BlockCodec::Lz;
+#endif
+    }
+
+    namespace detail
+    {
+        // Start of a file of compressed blocks
+        struct BlockFileHeader
+        {
+            char magic[8];
+            uint32_t order;
+            uint32_t version;
+        };
+
+        // Before every block, which decodes alone
+        struct BlockHeader
+        {
+            uint32_t tag;
+            uint8_t codec;
+            uint8_t reserved[3];
+            uint32_t raw_size;
+            uint32_t packed_size;
+        };
+
+        static_assert(sizeof(BlockFileHeader) == 16, "Unexpected block file header size");
+        static_assert(sizeof(BlockHeader) == 16, "Unexpected block header size");
+
+        inline size_t lzBound(size_t size)
+        {
+            return size + size / 255 + 16;
+        }
+
+        // Greedy LZ77 over a 64 KiB window with a hash of 4 bytes, written as LZ4 sequences
+        // table holds 1 << 14 entries and is only used by one thread at a time
+        inline size_t lzCompress(const char *src, size_t size, char *dst, uint32_t *table)
+        {
+            const int kHashBits = 14;
+            const uint8_t *in = reinterpret_cast<const uint8_t *>(src);
+            uint8_t *out = reinterpret_cast<uint8_t *>(dst);
+            auto read32 = [in](size_t pos)
+            {
+                uint32_t value;
+                std::memcpy(&value, in + pos, 4);
+                return value;
+            };
+            auto length = [&out](size_t value)
+            {
+                for (; value >= 255; value -= 255)
+                    *out++ = 255;
+                *out++ = static_cast<uint8_t>(value);
+            };
+            size_t anchor = 0;
+            if (size >= 13) // The format ends with at least 5 literals, a match starts 12 bytes before the end
+            {
+                std::fill(table, table + (1 << kHashBits), 0);
+                size_t limit = size - 12;
+                size_t pos = 0;
+                while (pos < limit)
+                {
+                    uint32_t seq = read32(pos);
+                    uint32_t hash = (seq * 2654435761u) >> (32 - kHashBits);
+                    size_t candidate = table[hash];
+                    table[hash] = static_cast<uint32_t>(pos + 1);
+                    if (candidate == 0 || pos - (candidate - 1) > 65535 || read32(candidate - 1) != seq)
+                    {
+                        pos += 1 + ((pos - anchor) >> 6); // Skip faster through text that does not repeat
+                        continue;
+                    }
+                    size_t ref = candidate - 1;
+                    while (pos > anchor && ref > 0 && in[pos - 1] == in[ref - 1])
+                    {
+                        --pos;
+                        --ref;
+                    }
+                    size_t len = 4;
+                    while (pos + len < size - 5 && in[pos + len] == in[ref + len])
+                        ++len;
+                    size_t literals = pos - anchor;
+                    uint8_t *token = out++;
+                    *token = static_cast<uint8_t>((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(len - 4, 15));
+                    if (literals >= 15)
+                        length(literals - 15);
+                    std::memcpy(out, in + anchor, literals);
+                    out += literals;
+                    size_t offset = pos - ref;
+                    *out++ = static_cast<uint8_t>(offset & 0xff);
+                    *out++ = static_cast<uint8_t>(offset >> 8);
+                    if (len - 4 >= 15)
+                        length(len - 4 - 15);
+                    pos += len;
+                    anchor = pos;
+                }
+            }
+            size_t literals = size - anchor;
+            *out++ = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+            if (literals >= 15)
+                length(literals - 15);
+            std::memcpy(out, in + anchor, literals);
+            out += literals;
+            return static_cast<size_t>(out - reinterpret_cast<uint8_t *>(dst));
+        }
+
+        // False for data that is not a block of exactly raw bytes
+        inline bool lzDecompress(const char *src, size_t size, char *dst, size_t raw)
+        {
+            const uint8_t *in = reinterpret_cast<const uint8_t *>(src);
+            const uint8_t *in_end = in + size;
+            uint8_t *out = reinterpret_cast<uint8_t *>(dst);
+            uint8_t *out_end = out + raw;
+            auto length = [&in, in_end](size_t &value)
+            {
+                uint8_t byte;
+                do
+                {
+                    if (in >= in_end)
+                        return false;
+                    byte = *in++;
+                    value += byte;
+                } while (byte == 255);
+                return true;
+            };
+            while (in < in_end)
+            {
+                uint8_t token = *in++;
+                size_t literals = token >> 4;
+                if (literals == 15 && !length(literals))
+                    return false;
+                if (literals > static_cast<size_t>(in_end - in) || literals > static_cast<size_t>(out_end - out))
+                    return false;
+                std::memcpy(out, in, literals);
+                in += literals;
+                out += literals;
+                if (in == in_end)
+                    break;
+                if (in_end - in < 2)
+                    return false;
+                size_t offset = in[0] | (static_cast<size_t>(in[1]) << 8);
+                in += 2;
+                size_t len = token & 15;
+                if (len == 15 && !length(len))
+                    return false;
+                len += 4;
+                if (offset == 0 || offset > static_cast<size_t>(out - reinterpret_cast<uint8_t *>(dst)) ||
+                    len > static_cast<size_t>(out_end - out))
+                    return false;
+                for (const uint8_t *from = out - offset; len > 0; --len) // Overlaps when offset < len
+                    *out++ = *from++;
+            }
+            return out == out_end;
+        }
+
+        // Unpacks one block into raw bytes, false for a codec this build does not have or damaged data
+        inline bool decodeBlock(BlockCodec codec, const char *src, size_t size, char *dst, size_t raw)
+        {
+            switch (codec)
+            {
+            case BlockCodec::Stored:
+                if (size != raw)
+                    return false;
+                std::memcpy(dst, src, raw);
+                return true;
+            case BlockCodec::Lz:
+                return lzDecompress(src, size, dst, raw);
+            case BlockCodec::Zlib:
+#ifdef SLOG_USE_ZLIB
+            {
+                uLongf len = static_cast<uLongf>(raw);
+                return uncompress(reinterpret_cast<Bytef *>(dst), &len, reinterpret_cast<const Bytef *>(src),
+                                  static_cast<uLong>(size)) == Z_OK &&
+                       len == raw;
+            }
+#else
+                return false;
+#endif
+            }
+            return false;
+        }
+    }
+
+    // File of independently compressed blocks of records, read with slog_unpack
+    // Records are collected under the output lock, a background thread packs and writes the blocks;
+    // a block is also handed over when it is older than max_delay, so the file can be followed
+    class CompressedFileSink : public Sink
+    {
+    private:
+        std::string _path;
+        int _fd;
+        size_t _block_size;
+        BlockCodec _codec;
+        std::chrono::milliseconds _max_delay; // 0 to wait for full blocks
+        std::vector<char> _block;             // Filled by producers under the output lock
+        std::chrono::steady_clock::time_point _block_start;
+        std::mutex _mutex; // Queue and state below
+        std::condition_variable _ready;
+        std::condition_variable _done;
+        std::vector<std::vector<char>> _queue; // Oldest first
+        std::vector<std::vector<char>> _spare;
+        size_t _busy; // Blocks taken by the compressor and not written yet
+        bool _running;
+        std::thread _thread;
+        uint64_t _raw_bytes;
+        uint64_t _packed_bytes;
+        std::atomic<uint64_t> _dropped; // Records lost while the compressor was behind
+
+        // Queues the current block, false when SLOG_BLOCK_QUEUE blocks are waiting already
+        // Never waits, producers hold the output lock; force goes past the limit for flush
+        bool handOff(bool force)
+        {
+            if (_block.empty())
+                return true;
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (!force && _queue.size() >= SLOG_BLOCK_QUEUE)
+                return false;
+            _queue.push_back(std::move(_block));
+            if (!_spare.empty())
+            {
+                _block = std::move(_spare.back());
+                _spare.pop_back();
+            }
+            else
+                _block = std::vector<char>();
+            _block.clear();
+            _block.reserve(_block_size);
+            lock.unlock();
+            _ready.notify_one();
+            return true;
+        }
+
+        // Returns the bytes written to the file for the block
+        size_t writeBlock(const std::vector<char> &raw, std::vector<char> &packed, std::vector<uint32_t> &table)
+        {
+            detail::BlockHeader header = {SLOG_BLOCK_TAG, static_cast<uint8_t>(_codec), {0, 0, 0},
+                                          static_cast<uint32_t>(raw.size()), 0};
+            size_t size = 0;
+            if (_codec == BlockCodec::Lz)
+            {
+                packed.resize(detail::lzBound(raw.size()));
+                size = detail::lzCompress(raw.data(), raw.size(), packed.data(), table.data());
+            }
+#ifdef SLOG_USE_ZLIB
+            else if (_codec == BlockCodec::Zlib)
+            {
+                uLongf len = compressBound(static_cast<uLong>(raw.size()));
+                packed.resize(len);
+                if (compress2(reinterpret_cast<Bytef *>(packed.data()), &len, reinterpret_cast<const Bytef *>(raw.data()),
+                              static_cast<uLong>(raw.size()), Z_BEST_SPEED) == Z_OK)
+                    size = len;
+            }
+#endif
+            const char *data = packed.data();
+            if (size == 0 || size >= raw.size())
+            {
+                header.codec = static_cast<uint8_t>(BlockCodec::Stored);
+                data = raw.data();
+                size = raw.size();
+            }
+            header.packed_size = static_cast<uint32_t>(size);
+            if (_fd >= 0)
+            {
+                detail::writeFile(_fd, reinterpret_cast<const char *>(&header), sizeof(header));
+                detail::writeFile(_fd, data, size);
+            }
+            return sizeof(header) + size;
+        }
+
+        void run()
+        {
+            std::vector<char> packed;
+            std::vector<uint32_t> table(1 << 14);
+            std::unique_lock<std::mutex> lock(_mutex);
+            for (;;)
+            {
+                if (_queue.empty())
+                {
+                    if (!_running)
+                        break;
+                    if (_max_delay.count() == 0)
+                    {
+                        _ready.wait(lock);
+                        continue;
+                    }
+                    _ready.wait_for(lock, _max_delay / 2);
+                    if (!_queue.empty() || !_running)
+                        continue;
+                    // A block left open too long is taken when no producer holds the output lock
+                    lock.unlock();
+                    if (detail::outputMutex().try_lock())
+                    {
+                        if (!_block.empty() && std::chrono::steady_clock::now() - _block_start >= _max_delay)
+                            handOff(true);
+                        detail::outputMutex().unlock();
+                    }
+                    lock.lock();
+                    continue;
+                }
+                std::vector<char> raw = std::move(_queue.front());
+                _queue.erase(_queue.begin());
+                ++_busy;
+                lock.unlock();
+                size_t written = writeBlock(raw, packed, table);
+                lock.lock();
+                _raw_bytes += raw.size();
+                _packed_bytes += written;
+                --_busy;
+                _spare.push_back(std::move(raw));
+                _done.notify_all();
+            }
+        }
+
+    public:
+        explicit CompressedFileSink(const char *path, bool append = true, BlockCodec codec = defaultCodec(),
+                                    std::chrono::milliseconds max_delay = std::chrono::milliseconds(1000),
+                                    size_t block_size = SLOG_BLOCK_SIZE)
+            : _path(path),
+              _fd(detail::openFile(path, append)),
+              _block_size(block_size),
+              _codec(codec),
+              _max_delay(max_delay),
+              _busy(0),
+              _running(true),
+              _raw_bytes(0),
+              _packed_bytes(0),
+              _dropped(0)
+        {
+#ifndef SLOG_USE_ZLIB
+            if (_codec == BlockCodec::Zlib)
+                _codec = BlockCodec::Lz;
+#endif
+            if (_fd >= 0 && detail::fileSize(_fd) == 0)
+            {
+                detail::BlockFileHeader header = {{0}, SLOG_BLOCK_ORDER, SLOG_BLOCK_VERSION};
+                std::memcpy(header.magic, SLOG_BLOCK_MAGIC, 8);
+                detail::writeFile(_fd, reinterpret_cast<const char *>(&header), sizeof(header));
+            }
+            _block.reserve(_block_size);
+            _thread = std::thread(&CompressedFileSink::run, this);
+        }
+        // Queued blocks are written by the thread, the open one after it stopped so nothing else touches it
+        ~CompressedFileSink()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running = false;
+            }
+            _ready.notify_one();
+            _thread.join();
+            if (!_block.empty())
+            {
+                std::vector<char> packed;
+                std::vector<uint32_t> table(1 << 14);
+                writeBlock(_block, packed, table);
+            }
+            if (_fd >= 0)
+                detail::closeFile(_fd);
+        }
+        CompressedFileSink(const CompressedFileSink &) = delete;
+        CompressedFileSink &operator=(const CompressedFileSink &) = delete;
+
+        bool isOpen() const
+        {
+            return _fd >= 0;
+        }
+
+        // With the queue full the open block keeps growing, up to SLOG_BLOCK_QUEUE blocks, then records are dropped
+        void write(CPLErr /* level */, int /* err_no */, const char *text, size_t size) override
+        {
+            if (_fd < 0)
+                return;
+            if (_block.size() >= _block_size && _block.size() + size > _block_size * SLOG_BLOCK_QUEUE &&
+                !handOff(false))
+            {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (_block.empty())
+                _block_start = std::chrono::steady_clock::now();
+            _block.insert(_block.end(), text, text + size);
+            if (_block.size() >= _block_size)
+                handOff(false);
+        }
+
+        // Waits until every record is packed and written
+        void flush() override
+        {
+            handOff(true);
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]()
+                       { return _queue.empty() && _busy == 0; });
+        }
+
+        // Text bytes and file bytes written so far, complete after flush
+        std::pair<uint64_t, uint64_t> written()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return std::make_pair(_raw_bytes, _packed_bytes);
+        }
+
+        // Records dropped because the compressor fell too far behind
+        uint64_t dropped() const
+        {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+    };
+
+    // The last capacity bytes of records kept in memory, for tests and crash dumps
+    class MemorySink : public Sink
+    {
+    private:
+        std::unique_ptr<char[]> _ring;
+        size_t _capacity;
+        uint64_t _total; // Bytes written since the start or the last clear
+
+    public:
+        explicit MemorySink(size_t capacity = 1 << 16)
+            : _ring(new char[capacity]),
+              _capacity(capacity),
+              _total(0)
+        {
+        }
+
+        void write(CPLErr /* level */, int /* err_no */, const char *text, size_t size) override
+        {
+            if (size > _capacity)
+            {
+                _total += size - _capacity;
+                text += size - _capacity;
+                size = _capacity;
+            }
+            size_t pos = static_cast<size_t>(_total % _capacity);
+            size_t first = std::min(size, _capacity - pos);
+            std::memcpy(_ring.get() + pos, text, first);
+            std::memcpy(_ring.get(), text + first, size - first);
+            _total += size;
+        }
+
+        // Complete records kept, oldest first
+        std::string contents() const
+        {
+            std::lock_guard<std::mutex> lock(detail::outputMutex());
+            if (_total <= _capacity)
+                return std::string(_ring.get(), static_cast<size_t>(_total));
+            size_t pos = static_cast<size_t>(_total % _capacity);
+            std::string text(_ring.get() + pos, _capacity - pos);
+            text.append(_ring.get(), pos);
+            size_t start = text.find('\n');
+            return start == std::string::npos ? std::string() : text.substr(start + 1);
+        }
+
+        void dump(FILE *file) const
+        {
+            std::string text = contents();
+            fwrite(text.data(), 1, text.size(), file);
+            fflush(file);
+        }
+
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(detail::outputMutex());
+            _total = 0;
+        }
+    };
+
+    // stderr, or CPLError when GDAL's cpl_error.h is included first
+    inline std::shared_ptr<Sink> defaultSink()
+    {
+#ifdef CPL_ERROR_H_INCLUDED
+        static std::shared_ptr<Sink> sink = std::make_shared<CplErrorSink>();
+#else
+        static std::shared_ptr<Sink> sink = std::make_shared<StderrSink>();
+#endif
+        return sink;
+    }
+
+    namespace detail
+    {
+        // Registered sinks, used and changed with the output lock held
+        inline std::vector<std::shared_ptr<Sink>> &sinks()
+        {
+            static std::vector<std::shared_ptr<Sink>> all(1, defaultSink());
+            return all;
+        }
+
+        // One record to every sink
+        inline void writeRecord(CPLErr level, int err_no, const char *text, size_t size)
+        {
+            std::lock_guard<std::mutex> lock(detail::outputMutex());
+            for (const std::shared_ptr<Sink> &sink : sinks())
+            {
+                sink->write(level, err_no, text, size);
+                sink->commit();
+            }
+        }
+
+        // Lines of one record, formatted before the output lock is taken and written at once
+        class RecordBuffer
+        {
+        private:
+            std::vector<char> _text;
+            size_t _used;
+
+        public:
+            RecordBuffer()
+                : _text(1024),
+                  _used(0)
+            {
+            }
+
+            void clear()
+            {
+                _used = 0;
+            }
+
+            template <typename FMT, typename... ARGS>
+            void line(CPLErr /* level */, int /* err_no */, FMT format, const ARGS &...args)
+            {
+                for (;;)
+                {
+                    size_t room = _text.size() - _used;
+                    int len = formatTo(&_text[_used], room, format, args...);
+                    if (len < 0)
+                        return;
+                    if (static_cast<size_t>(len) + 1 < room)
+                    {
+                        _used += static_cast<size_t>(len);
+                        _text[_used++] = '\n';
+                        return;
+                    }
+                    _text.resize(std::max(_text.size() * 2, _used + static_cast<size_t>(len) + 2));
+                }
+            }
+
+            const char *data() const
+            {
+                return _text.data();
+            }
+
+            size_t size() const
+            {
+                return _used;
+            }
+        };
+
+        inline RecordBuffer &recordBuffer()
+        {
+            thread_local RecordBuffer buffer;
+            return buffer;
+        }
+
+        // Format one SINFO call in the buffer of the thread, text is the literal format carries
+        template <typename FMT, typename... ARGS>
+        void writeFormatted(CPLErr level, int err_no, FMT format, const char * /* text */, const ARGS &...args)
+        {
+            RecordBuffer &record = recordBuffer();
+            record.clear();
+            record.line(level, err_no, format, args...);
+            writeRecord(level, err_no, record.data(), record.size());
+        }
+    }
+
+    // Add a sink next to the ones registered, records go to every sink
+    inline void addSink(std::shared_ptr<Sink> sink)
+    {
+        std::lock_guard<std::mutex> lock(detail::outputMutex());
+        detail::sinks().push_back(std::move(sink));
+    }
+
+    inline void removeSink(const std::shared_ptr<Sink> &sink)
+    {
+        std::lock_guard<std::mutex> lock(detail::outputMutex());
+        std::vector<std::shared_ptr<Sink>> &all = detail::sinks();
+        std::vector<std::shared_ptr<Sink>>::iterator found = std::find(all.begin(), all.end(), sink);
+        if (found == all.end())
+            return;
+        (*found)->flush();
+        all.erase(found);
+    }
+
+    // Remove every sink, the default one included
+    inline void clearSinks()
+    {
+        std::lock_guard<std::mutex> lock(detail::outputMutex());
+        for (const std::shared_ptr<Sink> &sink : detail::sinks())
+            sink->flush();
+        detail::sinks().clear();
+    }
+
+    inline void flushSinks()
+    {
+        std::lock_guard<std::mutex> lock(detail::outputMutex());
+        for (const std::shared_ptr<Sink> &sink : detail::sinks())
+            sink->flush();
+    }
+}
+
+namespace slog
+{
+    // What a producer does when the async ring is full
+    enum class OverflowPolicy
+    {
+        Block,       // Wait until the consumer frees a slot
+        DropNewest,  // Discard the new record
+        DropAndCount // Discard the new record and report how many were lost
+    };
+
+    namespace detail
+    {
+        // Scalars are copied at a fixed offset, strings are copied to the tail of the payload
+        struct PackCursor
+        {
+            unsigned char *base;
+            unsigned char *tail;
+            unsigned char *end;
+        };
+
+        template <typename T>
+        struct ArgPacker
+        {
+            static_assert(std::is_trivially_copyable<T>::value,
+                          "SINFO argument can not be packed into an async record");
+            using value_type = T;
+            static constexpr size_t fixed = sizeof(T);
+            static void pack(PackCursor &cursor, size_t offset, const T &value)
+            {
+                std::memcpy(cursor.base + offset, &value, sizeof(T));
+            }
+            static T unpack(const unsigned char *base, size_t offset)
+            {
+                T value;
+                std::memcpy(&value, base + offset, sizeof(T));
+                return value;
+            }
+        };
+
+        template <>
+        struct ArgPacker<const char *>
+        {
+            using value_type = const char *;
+            static constexpr size_t fixed = sizeof(uint16_t);
+            static constexpr uint16_t null_offset = 0xFFFF;
+            static void pack(PackCursor &cursor, size_t offset, const char *value)
+            {
+                uint16_t pos = null_offset;
+                if (value != nullptr)
+                {
+                    // The last byte of the payload is always '\0', a full payload truncates to ""
+                    size_t room = static_cast<size_t>(cursor.end - cursor.tail);
+                    size_t len = std::min(std::strlen(value), room > 0 ? room - 1 : 0);
+                    pos = static_cast<uint16_t>(cursor.tail - cursor.base);
+                    std::memcpy(cursor.tail, value, len);
+                    cursor.tail[len] = '\0';
+                    cursor.tail += (room > 0 ? len + 1 : 0);
+                }
+                std::memcpy(cursor.base + offset, &pos, sizeof(pos));
+            }
+            static const char *unpack(const unsigned char *base, size_t offset)
+            {
+                uint16_t pos;
+                std::memcpy(&pos, base + offset, sizeof(pos));
+                if (pos == null_offset)
+                    return "(null)";
+                return reinterpret_cast<const char *>(base + pos);
+            }
+        };
+
+        template <>
+        struct ArgPacker<char *> : ArgPacker<const char *>
+        {
+        };
+
+        // Offset of the index-th argument in the fixed part of the payload
+        template <typename... ARGS>
+        constexpr size_t packedOffset(size_t index)
+        {
+            const size_t sizes[] = {ArgPacker<ARGS>::fixed..., 0};
+            size_t offset = 0;
+            for (size_t i = 0; i < index; ++i)
+                offset += sizes[i];
+            return offset;
+        }
+
+        template <typename FMT, typename... ARGS, size_t... I>
+        int renderPacked(char *out, size_t size, const unsigned char *payload, std::index_sequence<I...>)
+        {
+            return formatTo(out, size, FMT(), ArgPacker<ARGS>::unpack(payload, packedOffset<ARGS...>(I))...);
+        }
+
+        template <typename FMT, typename... ARGS>
+        int renderPacked(char *out, size_t size, const char * /* fmt */, const unsigned char *payload)
+        {
+            return renderPacked<FMT, ARGS...>(out, size, payload, std::index_sequence_for<ARGS...>());
+        }
+
+        template <typename... ARGS, size_t... I>
+        void packArgs(PackCursor &cursor, std::index_sequence<I...>, const ARGS &...args)
+        {
+            int expand[] = {0, (ArgPacker<std::decay_t<ARGS>>::pack(
+                                    cursor, packedOffset<std::decay_t<ARGS>...>(I), args),
+                                0)...};
+            (void)expand;
+        }
+
+        typedef int (*RenderFn)(char *out, size_t size, const char *fmt, const unsigned char *payload);
+
+        // Compact binary form of one SINFO call
+        struct AsyncRecord
+        {
+            CPLErr level;
+            int err_no;
+            const char *fmt;
+            RenderFn render;
+            unsigned char payload[SLOG_ASYNC_PAYLOAD_SIZE];
+        };
+
+        // Bounded lock-free ring with many producers and one consumer
+        // Every slot carries a sequence number telling whose turn it is (D. Vyukov)
+        class AsyncRing
+        {
+        private:
+            struct Slot
+            {
+                std::atomic<size_t> seq;
+                AsyncRecord record;
+            };
+
+            // Keep the producer and consumer positions on separate cache lines
+            std::unique_ptr<Slot[]> _slots;
+            size_t _mask;
+            char _pad0[64];
+            std::atomic<size_t> _enqueue_pos;
+            char _pad1[64];
+            size_t _dequeue_pos;
+
+        public:
+            explicit AsyncRing(size_t capacity)
+                : _enqueue_pos(0),
+                  _dequeue_pos(0)
+            {
+                size_t size = 2;
+                while (size < capacity)
+                    size <<= 1;
+                _slots.reset(new Slot[size]);
+                _mask = size - 1;
+                for (size_t i = 0; i < size; ++i)
+                    _slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+            // Producer: reserve the next slot, nullptr when the ring is full
+            AsyncRecord *claim(size_t &pos)
+            {
+                pos = _enqueue_pos.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    Slot &slot = _slots[pos & _mask];
+                    size_t seq = slot.seq.load(std::memory_order_acquire);
+                    std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+                    if (diff == 0)
+                    {
+                        if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                            return &slot.record;
+                    }
+                    else if (diff < 0)
+                        return nullptr;
+                    else
+                        pos = _enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+            // Producer: hand the claimed slot over to the consumer
+            void publish(size_t pos)
+            {
+                _slots[pos & _mask].seq.store(pos + 1, std::memory_order_release);
+            }
+            // Consumer: oldest published record, nullptr when none is ready
+            AsyncRecord *front()
+            {
+                Slot &slot = _slots[_dequeue_pos & _mask];
+                if (slot.seq.load(std::memory_order_acquire) != _dequeue_pos + 1)
+                    return nullptr;
+                return &slot.record;
+            }
+            // Consumer: give the front slot back to the producers
+            void pop()
+            {
+                _slots[_dequeue_pos & _mask].seq.store(_dequeue_pos + _mask + 1, std::memory_order_release);
+                ++_dequeue_pos;
+            }
+            size_t enqueued() const
+            {
+                return _enqueue_pos.load(std::memory_order_acquire);
+            }
+            size_t dequeued() const
+            {
+                return _dequeue_pos;
+            }
+        };
+    }
+
+    // Opt-in asynchronous backend of SINFO
+    // Producers pack their arguments into the ring, a consumer thread formats and writes them in batches
+    class AsyncLogger
+    {
+    private:
+        std::unique_ptr<detail::AsyncRing> _ring;
+        OverflowPolicy _policy;
+        std::atomic<bool> _enabled;
+        std::atomic<bool> _running;
+        std::atomic<bool> _sleeping;
+        std::atomic<int> _inflight;
+        std::atomic<uint64_t> _dropped;
+        std::atomic<size_t> _written;
+        std::thread _consumer;
+        std::mutex _control_mutex;
+        std::mutex _wake_mutex;
+        std::condition_variable _wake_cv;
+        std::condition_variable _flush_cv;
+
+        void wake()
+        {
+            if (_sleeping.load())
+                _wake_cv.notify_one();
+        }
+
+        struct Line
+        {
+            size_t offset;
+            size_t size;
+            CPLErr level;
+            int err_no;
+        };
+
+        // Render one record after the others, returns false when the batch has no room left
+        bool render(std::vector<char> &batch, size_t &used, std::vector<Line> &lines, detail::AsyncRecord &record)
+        {
+            size_t room = batch.size() - used;
+            int len = record.render(&batch[used], room, record.fmt, record.payload);
+            if (len < 0)
+                len = 0;
+            if (static_cast<size_t>(len) + 1 >= room)
+            {
+                if (used > 0)
+                    return false;
+                len = static_cast<int>(room - 2); // A single line longer than the batch is truncated
+            }
+            lines.push_back(Line{used, static_cast<size_t>(len) + 1, record.level, record.err_no});
+            used += static_cast<size_t>(len);
+            batch[used++] = '\n';
+            return true;
+        }
+
+        // Hand a rendered batch to the sinks under one lock
+        void write(const std::vector<char> &batch, size_t &used, std::vector<Line> &lines)
+        {
+            if (!lines.empty())
+            {
+                std::lock_guard<std::mutex> lock(detail::outputMutex());
+                for (const std::shared_ptr<Sink> &sink : detail::sinks())
+                {
+                    for (const Line &line : lines)
+                        sink->write(line.level, line.err_no, &batch[line.offset], line.size);
+                    sink->commit();
+                }
+            }
+            used = 0;
+            lines.clear();
+        }
+
+        void consume()
+        {
+            std::vector<char> batch(SLOG_ASYNC_BATCH_SIZE);
+            std::vector<Line> lines;
+            uint64_t reported = 0;
+            for (;;)
+            {
+                size_t used = 0;
+                size_t count = 0;
+                while (detail::AsyncRecord *record = _ring->front())
+                {
+                    if (!render(batch, used, lines, *record))
+                    {
+                        write(batch, used, lines);
+                        continue;
+                    }
+                    _ring->pop();
+                    ++count;
+                }
+                uint64_t dropped = _dropped.load(std::memory_order_relaxed);
+                if (_policy == OverflowPolicy::DropAndCount && dropped != reported)
+                {
+                    char line[64];
+                    int len = std::snprintf(line, sizeof(line), "  [Dropped]\t%llu records\n",
+                                            static_cast<unsigned long long>(dropped - reported));
+                    if (used + len > batch.size())
+                        write(batch, used, lines);
+                    std::memcpy(&batch[used], line, static_cast<size_t>(len));
+                    lines.push_back(Line{used, static_cast<size_t>(len), CE_Warning, CPLE_None});
+                    used += static_cast<size_t>(len);
+                    reported = dropped;
+                }
+                write(batch, used, lines);
+                {
+                    std::lock_guard<std::mutex> lock(_wake_mutex);
+                    _written.store(_ring->dequeued(), std::memory_order_release);
+                }
+                _flush_cv.notify_all();
+                if (count > 0)
+                    continue;
+                if (!_running.load() && _ring->dequeued() == _ring->enqueued())
+                    return;
+                std::unique_lock<std::mutex> lock(_wake_mutex);
+                _sleeping.store(true);
+                if (_ring->front() == nullptr && _running.load())
+                    _wake_cv.wait_for(lock, std::chrono::milliseconds(10));
+                _sleeping.store(false);
+            }
+        }
+
+    public:
+        AsyncLogger()
+            : _policy(OverflowPolicy::Block),
+              _enabled(false),
+              _running(false),
+              _sleeping(false),
+              _inflight(0),
+              _dropped(0),
+              _written(0)
+        {
+            detail::sinks(); // Constructed first so it outlives the consumer at exit
+        }
+        ~AsyncLogger()
+        {
+            shutdown();
+        }
+        AsyncLogger(const AsyncLogger &) = delete;
+        AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+        // Start the consumer thread, the ring capacity is rounded up to a power of two
+        bool start(size_t capacity, OverflowPolicy policy)
+        {
+            std::lock_guard<std::mutex> control(_control_mutex);
+            if (_running.load())
+                return false;
+            _ring.reset(new detail::AsyncRing(capacity));
+            _policy = policy;
+            _dropped.store(0);
+            _written.store(0);
+            _running.store(true);
+            _consumer = std::thread(&AsyncLogger::consume, this);
+            _enabled.store(true);
+            return true;
+        }
+
+        // Stop accepting records, write everything already queued and join the consumer
+        void shutdown()
+        {
+            std::lock_guard<std::mutex> control(_control_mutex);
+            if (!_running.load())
+                return;
+            _enabled.store(false);
+            while (_inflight.load() != 0)
+                std::this_thread::yield();
+            _running.store(false);
+            _wake_cv.notify_one();
+            _consumer.join();
+        }
+
+        // Block until every record pushed before this call has been written
+        void flush()
+        {
+            if (!_running.load())
+                return;
+            size_t target = _ring->enqueued();
+            std::unique_lock<std::mutex> lock(_wake_mutex);
+            while (_running.load() && _written.load(std::memory_order_acquire) < target)
+            {
+                _wake_cv.notify_one();
+                _flush_cv.wait_for(lock, std::chrono::milliseconds(10));
+            }
+        }
+
+        bool enabled() const
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        uint64_t dropped() const
+        {
+            return _dropped.load(std::memory_order_relaxed);
+        }
+
+        // Queue one record rendered later by render, false when the async mode is off
+        template <typename... ARGS>
+        bool enqueue(CPLErr level, int err_no, const char *fmt, detail::RenderFn render, const ARGS &...args)
+        {
+            static_assert(detail::packedOffset<std::decay_t<ARGS>...>(sizeof...(ARGS)) < SLOG_ASYNC_PAYLOAD_SIZE,
+                          "Too many SINFO arguments for one async record");
+            _inflight.fetch_add(1);
+            if (!_enabled.load())
+            {
+                _inflight.fetch_sub(1);
+                return false;
+            }
+            size_t pos;
+            detail::AsyncRecord *record = _ring->claim(pos);
+            while (record == nullptr)
+            {
+                if (_policy != OverflowPolicy::Block)
+                {
+                    if (_policy == OverflowPolicy::DropAndCount)
+                        _dropped.fetch_add(1, std::memory_order_relaxed);
+                    _inflight.fetch_sub(1, std::memory_order_release);
+                    return true;
+                }
+                wake();
+                std::this_thread::yield();
+                record = _ring->claim(pos);
+            }
+            record->level = level;
+            record->err_no = err_no;
+            record->fmt = fmt;
+            record->render = render;
+            detail::PackCursor cursor{record->payload,
+                                      record->payload + detail::packedOffset<std::decay_t<ARGS>...>(sizeof...(ARGS)),
+                                      record->payload + SLOG_ASYNC_PAYLOAD_SIZE - 1};
+            *cursor.end = '\0';
+            detail::packArgs(cursor, std::index_sequence_for<ARGS...>(), args...);
+            _ring->publish(pos);
+            _inflight.fetch_sub(1, std::memory_order_release);
+            wake();
+            return true;
+        }
+
+        // Queue one SINFO call, written synchronously when the async mode was shut down meanwhile
+        template <typename FMT, typename... ARGS>
+        void push(CPLErr level, int err_no, FMT format, const char *text, const ARGS &...args)
+        {
+            if (!enqueue(level, err_no, text, &detail::renderPacked<FMT, std::decay_t<ARGS>...>, args...))
+                detail::writeFormatted(level, err_no, format, text, args...);
+        }
+    };
+
+    inline AsyncLogger &asyncLogger()
+    {
+        static AsyncLogger logger;
+        return logger;
+    }
+
+    // Switch SINFO to the asynchronous backend
+    inline bool startAsync(size_t capacity = 8192, OverflowPolicy policy = OverflowPolicy::Block)
+    {
+        return asyncLogger().start(capacity, policy);
+    }
+
+    // Write all queued records, then switch SINFO back to synchronous writes
+    inline void shutdownAsync()
+    {
+        asyncLogger().shutdown();
+    }
+
+    // Wait until all records queued so far reach the sinks, then flush the sinks
+    inline void flush()
+    {
+        asyncLogger().flush();
+        flushSinks();
+    }
+
+    // Number of records lost under OverflowPolicy::DropAndCount
+    inline uint64_t droppedRecords()
+    {
+        return asyncLogger().dropped();
+    }
+}
+
+#ifndef SLOG_FLIGHT_TEXT_SIZE
+#define SLOG_FLIGHT_TEXT_SIZE 96 // Bytes of text in one flight recorder slot, the slot is 32 bytes more
+#endif
+
+#define SLOG_FLIGHT_MAGIC "SLOGFLT1"
+#define SLOG_FLIGHT_VERSION 1
+#define SLOG_FLIGHT_ORDER 0x01020304 // Written in native byte order
+#define SLOG_FLIGHT_FILLING (uint64_t(1) << 63) // Sequence bit of a slot being written
+
+namespace slog
+{
+    namespace detail
+    {
+        // Layout of a flight recorder file, read back by slog_flight
+        // The header, sites[sites] and slots[slots] follow each other
+        struct FlightHeader
+        {
+            char magic[8];
+            uint32_t order;
+            uint32_t version;
+            uint32_t slots; // Power of two
+            uint32_t sites;
+            uint32_t text_size;
+            int32_t pid;
+            std::atomic<uint64_t> next; // Records claimed so far
+            char reserved[24];
+        };
+
+        // Names of the call site with the same id, state is 2 once they are complete
+        struct FlightSite
+        {
+            std::atomic<uint32_t> state;
+            int32_t line;
+            char func[64];
+            char file[128];
+            char args[56];
+        };
+
+        // One record, seq is its position plus one once complete and 0 while it is written
+        struct FlightSlot
+        {
+            std::atomic<uint64_t> seq;
+            int64_t time;
+            int64_t value;
+            uint32_t site; // 0 for a SINFO record
+            uint8_t kind;  // EventKind, 0 for a SINFO record
+            uint8_t level;
+            uint16_t size;
+            char text[SLOG_FLIGHT_TEXT_SIZE];
+        };
+
+        static_assert(sizeof(FlightHeader) == 64, "Unexpected flight recorder header size");
+        static_assert(sizeof(FlightSite) == 256, "Unexpected flight recorder site size");
+
+        inline void copyText(char *out, size_t size, const char *text)
+        {
+            size_t len = text != nullptr ? std::min(std::strlen(text), size - 1) : 0;
+            std::memcpy(out, text != nullptr ? text : "", len);
+            out[len] = '\0';
+        }
+
+        // One mapped flight recorder file, writers claim a slot with one atomic add and never call the system
+        struct FlightMap
+        {
+            FlightHeader *header;
+            FlightSite *sites;
+            FlightSlot *slots;
+            uint64_t mask;
+            void *base;
+            size_t size;
+
+            // The slot is marked as being filled, readers skip it until it is published
+            FlightSlot &claim(uint64_t &seq)
+            {
+                uint64_t index = header->next.fetch_add(1, std::memory_order_relaxed);
+                FlightSlot &slot = slots[index & mask];
+                seq = index + 1;
+                slot.seq.store(seq | SLOG_FLIGHT_FILLING, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                return slot;
+            }
+
+            // A writer lapped by another one while filling its slot loses its record
+            void publish(FlightSlot &slot, uint64_t seq)
+            {
+                uint64_t filling = seq | SLOG_FLIGHT_FILLING;
+                slot.seq.compare_exchange_strong(filling, seq, std::memory_order_release, std::memory_order_relaxed);
+            }
+
+            // Names of a call site, written by the first thread recording it
+            void define(uint32_t id, const char *func, const char *file, const char *args, int line)
+            {
+                if (id >= header->sites)
+                    return;
+                FlightSite &site = sites[id];
+                uint32_t state = site.state.load(std::memory_order_acquire);
+                if (state != 0 || !site.state.compare_exchange_strong(state, 1, std::memory_order_acquire))
+                    return;
+                site.line = line;
+                copyText(site.func, sizeof(site.func), func);
+                copyText(site.file, sizeof(site.file), file);
+                copyText(site.args, sizeof(site.args), args);
+                site.state.store(2, std::memory_order_release);
+            }
+
+            void record(uint8_t kind, uint32_t site, int64_t time, int64_t value, CPLErr level, const char *text)
+            {
+                uint64_t seq;
+                FlightSlot &slot = claim(seq);
+                slot.time = time;
+                slot.value = value;
+                slot.site = site;
+                slot.kind = kind;
+                slot.level = static_cast<uint8_t>(level);
+                size_t len = text != nullptr ? std::min(std::strlen(text), sizeof(slot.text) - 1) : 0;
+                std::memcpy(slot.text, text != nullptr ? text : "", len);
+                slot.text[len] = '\0';
+                slot.size = static_cast<uint16_t>(len);
+                publish(slot, seq);
+            }
+
+            // A SINFO record, formatted straight into its slot
+            template <typename FMT, typename... ARGS>
+            void message(CPLErr level, FMT format, const char * /* text */, const ARGS &...args)
+            {
+                uint64_t seq;
+                FlightSlot &slot = claim(seq);
+                slot.time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                std::chrono::system_clock::now().time_since_epoch())
+                                .count();
+                slot.value = 0;
+                slot.site = 0;
+                slot.kind = 0;
+                slot.level = static_cast<uint8_t>(level);
+                int len = formatTo(slot.text, sizeof(slot.text), format, args...);
+                slot.size = static_cast<uint16_t>(std::max(0, std::min<int>(len, sizeof(slot.text) - 1)));
+                publish(slot, seq);
+            }
+        };
+    }
+
+    // Crash-survivable ring of the last records in a memory-mapped file
+    // The mapped pages belong to the file, so they outlive a crash of the process
+    class FlightRecorder
+    {
+    private:
+        std::mutex _mutex;
+        std::atomic<detail::FlightMap *> _map;
+        // Closed maps stay mapped, a writer that loaded one may still be using it
+        std::vector<std::unique_ptr<detail::FlightMap>> _maps;
+
+    public:
+        FlightRecorder()
+            : _map(nullptr)
+        {
+        }
+        FlightRecorder(const FlightRecorder &) = delete;
+        FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+        // Current map, nullptr when closed
+        detail::FlightMap *map() const
+        {
+            return _map.load(std::memory_order_acquire);
+        }
+
+        // Create path holding the last slots records, slots is rounded up to a power of two
+        bool open(const char *path, size_t slots, uint32_t sites)
+        {
+#ifdef _WIN32
+            (void)path;
+            (void)slots;
+            (void)sites;
+            return false;
+#else
+            std::lock_guard<std::mutex> lock(_mutex);
+            _map.store(nullptr, std::memory_order_release);
+            size_t count = 2;
+            while (count < slots)
+                count <<= 1;
+            size_t size = sizeof(detail::FlightHeader) + sites * sizeof(detail::FlightSite) +
+                          count * sizeof(detail::FlightSlot);
+            int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0)
+                return false;
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED)
+                return false;
+            std::unique_ptr<detail::FlightMap> map(new detail::FlightMap);
+            map->base = base;
+            map->size = size;
+            map->header = static_cast<detail::FlightHeader *>(base);
+            map->sites = reinterpret_cast<detail::FlightSite *>(map->header + 1);
+            map->slots = reinterpret_cast<detail::FlightSlot *>(map->sites + sites);
+            map->mask = count - 1;
+            std::memcpy(map->header->magic, SLOG_FLIGHT_MAGIC, 8);
+            map->header->order = SLOG_FLIGHT_ORDER;
+            map->header->version = SLOG_FLIGHT_VERSION;
+            map->header->slots = static_cast<uint32_t>(count);
+            map->header->sites = sites;
+            map->header->text_size = SLOG_FLIGHT_TEXT_SIZE;
+            map->header->pid = static_cast<int32_t>(::getpid());
+            _map.store(map.get(), std::memory_order_release);
+            _maps.push_back(std::move(map));
+            return true;
+#endif
+        }
+
+        // Stop recording, the file keeps the last records
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            detail::FlightMap *map = _map.exchange(nullptr, std::memory_order_acq_rel);
+#ifndef _WIN32
+            if (map != nullptr)
+                ::msync(map->base, map->size, MS_ASYNC);
+#else
+            (void)map;
+#endif
+        }
+    };
+
+    inline FlightRecorder &flightRecorder()
+    {
+        static FlightRecorder recorder;
+        return recorder;
+    }
+
+    // Record the entry and end of decorated calls and SENTRY scopes, failures and SINFO records into path
+    // Writes go to shared memory only, the file holds the last slots records even after a crash
+    inline bool openFlightRecorder(const char *path, size_t slots = 4096, uint32_t sites = 1024)
+    {
+        return flightRecorder().open(path, slots, sites);
+    }
+
+    inline void closeFlightRecorder()
+    {
+        flightRecorder().close();
+    }
+}
+
+// Write without any level check, the format has to be a string literal and is checked at compile time
+#define SLOG_WRITE(eErrClass, err_no, ...)                                             \
+    do                                                                                 \
+    {                                                                                  \
+        auto slog_format = SLOG_FORMAT(SLOG_FIRST(__VA_ARGS__));                       \
+        if (slog::detail::FlightMap *slog_flight = slog::flightRecorder().map())       \
+            slog_flight->message(eErrClass, slog_format, __VA_ARGS__);                 \
+        if (!slog::asyncLogger().enabled())                                            \
+            slog::detail::writeFormatted(eErrClass, err_no, slog_format, __VA_ARGS__); \
+        else                                                                           \
+            slog::asyncLogger().push(eErrClass, err_no, slog_format, __VA_ARGS__);     \
+        if (eErrClass == CE_Fatal)                                                     \
+        {                                                                              \
+            slog::flush();                                                             \
+            exit(1);                                                                   \
+        }                                                                              \
+    } while (0)
+
+// Lowest level compiled in: 1 CE_Debug, 2 CE_Warning, 3 CE_Failure, 4 CE_Fatal, 5 nothing
+// Calls below it are removed by the compiler, including their arguments
+#ifndef SLOG_ACTIVE_LEVEL
+#define SLOG_ACTIVE_LEVEL 1
+#endif
+
+// Lowest level written at startup, can be changed at runtime with slog::setLevel
+#ifndef SLOG_DEFAULT_LEVEL
+#define SLOG_DEFAULT_LEVEL 1
+#endif
+
+namespace slog
+{
+    namespace detail
+    {
+        inline std::atomic<int> &globalLevel()
+        {
+            static std::atomic<int> level(SLOG_DEFAULT_LEVEL);
+            return level;
+        }
+    }
+
+    // Checked before anything is formatted, one relaxed load
+    inline bool shouldLog(CPLErr level)
+    {
+        return static_cast<int>(level) >= SLOG_ACTIVE_LEVEL &&
+               static_cast<int>(level) >= detail::globalLevel().load(std::memory_order_relaxed);
+    }
+
+    // Flight recorder keeping records of this level, also those below the level written
+    inline detail::FlightMap *flightMap(CPLErr level)
+    {
+        return static_cast<int>(level) >= SLOG_ACTIVE_LEVEL ? flightRecorder().map() : nullptr;
+    }
+
+    namespace detail
+    {
+        // Text of a format only known at runtime, for SINFO_RT
+        inline std::string formatRuntime(const char *fmt, ...)
+        {
+            va_list args;
+            va_start(args, fmt);
+            va_list copy;
+            va_copy(copy, args);
+            int size = vsnprintf(nullptr, 0, fmt, copy);
+            va_end(copy);
+            std::string text(size > 0 ? static_cast<size_t>(size) : 0, '\0');
+            if (size > 0)
+                vsnprintf(&text[0], text.size() + 1, fmt, args);
+            va_end(args);
+            return text;
+        }
+    }
+}
+
+// CE_Fatal ends the program even when its record is filtered out
+#define SINFO(eErrClass, err_no, ...)                                                               \
+    do                                                                                              \
+    {                                                                                               \
+        if (slog::shouldLog(eErrClass))                                                             \
+            SLOG_WRITE(eErrClass, err_no, __VA_ARGS__);                                             \
+        else                                                                                        \
+        {                                                                                           \
+            if (slog::detail::FlightMap *slog_flight = slog::flightMap(eErrClass))                  \
+                slog_flight->message(eErrClass, SLOG_FORMAT(SLOG_FIRST(__VA_ARGS__)), __VA_ARGS__); \
+            if (eErrClass == CE_Fatal)                                                              \
+            {                                                                                       \
+                slog::flush();                                                                      \
+                exit(1);                                                                            \
+            }                                                                                       \
+        }                                                                                           \
+    } while (0)
+
+// SINFO with a format built at runtime, formatted by vsnprintf without the compile-time checks
+#define SINFO_RT(eErrClass, err_no, ...) SINFO(eErrClass, err_no, "%s", slog::detail::formatRuntime(__VA_ARGS__).c_str())
+
+#ifndef SLOG_TIME_BUFFER_SIZE
+#define SLOG_TIME_BUFFER_SIZE 32 // Enough for "YYYY/MM/DD HH:MM:SS.ffffff"
+#endif
+
+namespace slog
+{
+    // Digits printed after the second
+    enum class TimePrecision
+    {
+        Second = 0,
+        Milli = 3,
+        Micro = 6
+    };
+
+    namespace detail
+    {
+        inline std::atomic<int> &timePrecision()
+        {
+            static std::atomic<int> precision(static_cast<int>(TimePrecision::Second));
+            return precision;
+        }
+
+        inline std::atomic<bool> &timeUTC()
+        {
+            static std::atomic<bool> utc(false);
+            return utc;
+        }
+
+        // Thread-safe replacement of std::localtime and std::gmtime
+        inline bool splitTime(std::time_t t, bool utc, std::tm &out)
+        {
+#ifdef _WIN32
+            return (utc ? gmtime_s(&out, &t) : localtime_s(&out, &t)) == 0;
+#else
+            return (utc ? gmtime_r(&t, &out) : localtime_r(&t, &out)) != nullptr;
+#endif
+        }
+
+        // "YYYY/MM/DD HH:MM:SS" of the last second formatted by this thread
+        struct TimeCache
+        {
+            int64_t second;
+            bool utc;
+            size_t len;
+            char prefix[SLOG_TIME_BUFFER_SIZE];
+        };
+    }
+
+    inline void setTimePrecision(TimePrecision precision)
+    {
+        detail::timePrecision().store(static_cast<int>(precision), std::memory_order_relaxed);
+    }
+
+    inline void setTimeUTC(bool utc)
+    {
+        detail::timeUTC().store(utc, std::memory_order_relaxed);
+    }
+
+    // Format a wall clock time given in nanoseconds since the epoch into buf
+    // The date part is rebuilt once per second per thread, only the fraction is patched in
+    // Returns the length written, without the terminating '\0'
+    inline size_t formatTime(char *buf, size_t size, int64_t ns, TimePrecision precision, bool utc)
+    {
+        thread_local detail::TimeCache cache = {std::numeric_limits<int64_t>::min(), false, 0, {0}};
+        if (size == 0)
+            return 0;
+        int64_t second = ns / 1000000000;
+        int64_t fraction = ns % 1000000000;
+        if (fraction < 0)
+        {
+            fraction += 1000000000;
+            --second;
+        }
+        if (second != cache.second || utc != cache.utc)
+        {
+            std::tm parts;
+            cache.len = 0;
+            if (detail::splitTime(static_cast<std::time_t>(second), utc, parts))
+                cache.len = std::strftime(cache.prefix, sizeof(cache.prefix), "%Y/%m/%d %H:%M:%S", &parts);
+            cache.second = second;
+            cache.utc = utc;
+        }
+        char out[SLOG_TIME_BUFFER_SIZE];
+        size_t len = cache.len;
+        std::memcpy(out, cache.prefix, len);
+        int digits = static_cast<int>(precision);
+        if (digits > 0)
+        {
+            static const int64_t divisors[] = {1000000000, 100000000, 10000000, 1000000,
+                                               100000, 10000, 1000, 100, 10, 1};
+            int64_t value = fraction / divisors[digits];
+            out[len++] = '.';
+            for (int i = digits - 1; i >= 0; --i)
+            {
+                out[len + i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            len += static_cast<size_t>(digits);
+        }
+        len = std::min(len, size - 1);
+        std::memcpy(buf, out, len);
+        buf[len] = '\0';
+        return len;
+    }
+
+    // Wall clock in nanoseconds since the epoch
+    inline int64_t wallTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Format with the global precision and time zone settings
+    inline size_t formatTime(char *buf, size_t size, int64_t ns)
+    {
+        return formatTime(buf, size, ns,
+                          static_cast<TimePrecision>(detail::timePrecision().load(std::memory_order_relaxed)),
+                          detail::timeUTC().load(std::memory_order_relaxed));
+    }
+
+    inline size_t formatTime(char *buf, size_t size)
+    {
+        return formatTime(buf, size, wallTime());
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SLOG_HAS_TSC
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace slog
+{
+    // Clock policies of runFunction
+    // now() returns raw ticks, toNs() converts a tick count when a record is written
+    typedef int64_t (*ToNsFn)(int64_t ticks);
+
+    struct SteadyClock
+    {
+        static int64_t now()
+        {
+            return static_cast<int64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        }
+        static int64_t toNs(int64_t ticks)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::duration(ticks))
+                .count();
+        }
+    };
+
+    // CLOCK_MONOTONIC_RAW, not slewed by NTP; steady_clock where it does not exist
+    struct RawClock
+    {
+        static int64_t now()
+        {
+#if defined(CLOCK_MONOTONIC_RAW)
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+            return SteadyClock::toNs(SteadyClock::now());
+#endif
+        }
+        static int64_t toNs(int64_t ticks)
+        {
+            return ticks;
+        }
+    };
+
+    // Time stamp counter read with rdtscp, calibrated once against steady_clock
+    // Falls back to steady_clock on other architectures
+    struct TscClock
+    {
+        static int64_t now()
+        {
+#ifdef SLOG_HAS_TSC
+            unsigned int aux;
+            return static_cast<int64_t>(__rdtscp(&aux));
+#else
+            return SteadyClock::now();
+#endif
+        }
+        // Nanoseconds per tick, measured on first use; call it at startup to keep the 10 ms spin out of the logs
+        static double calibrate()
+        {
+#ifdef SLOG_HAS_TSC
+            static const double ratio = []()
+            {
+                auto begin = std::chrono::steady_clock::now();
+                int64_t ticks = now();
+                while (std::chrono::steady_clock::now() - begin < std::chrono::milliseconds(10))
+                    ;
+                int64_t elapsed_ticks = now() - ticks;
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - begin);
+                return static_cast<double>(elapsed.count()) / static_cast<double>(elapsed_ticks);
+            }();
+            return ratio;
+#else
+            return 1.0;
+#endif
+        }
+        static int64_t toNs(int64_t ticks)
+        {
+#ifdef SLOG_HAS_TSC
+            return static_cast<int64_t>(static_cast<double>(ticks) * calibrate());
+#else
+            return SteadyClock::toNs(ticks);
+#endif
+        }
+    };
+}
+
+#ifndef SLOG_CLOCK
+#define SLOG_CLOCK slog::SteadyClock // Default clock of TimeLog and SENTRY
+#endif
+
+namespace slog
+{
+    typedef SLOG_CLOCK DefaultClock;
+}
+
+// Get current time
+inline std::string nowTimeStr()
+{
+    char buffer[SLOG_TIME_BUFFER_SIZE];
+    size_t len = slog::formatTime(buffer, sizeof(buffer));
+    return std::string(buffer, len);
+}
+
+namespace slog
+{
+    // Which successful calls of a site are written, every condition set has to hold
+    // Failures are never sampled out
+    struct Sampling
+    {
+        uint32_t one_in;        // Write one call in one_in, 0 or 1 for every call
+        uint32_t per_second;    // Write at most per_second calls a second, 0 for no limit
+        int64_t slower_than_ns; // Write only calls taking at least this long, 0 for every call
+    };
+
+    inline Sampling oneIn(uint32_t count)
+    {
+        return Sampling{count, 0, 0};
+    }
+
+    inline Sampling perSecond(uint32_t count)
+    {
+        return Sampling{0, count, 0};
+    }
+
+    inline Sampling slowerThan(std::chrono::nanoseconds duration)
+    {
+        return Sampling{0, 0, static_cast<int64_t>(duration.count())};
+    }
+
+    // Static description of one decorated call site
+    // Built once per macro expansion, only holds pointers to string literals
+    struct CallSite
+    {
+        const char *func_name;
+        const char *file_name;
+        const char *args_name; // nullptr for SENTRY, SACTION and argument checks
+        int line_no;
+        mutable std::atomic<uint32_t> id;                   // Assigned on first use by the binary log, 0 until then
+        mutable std::atomic<uint32_t> level;                // Resolved level and the generation it was resolved in
+        mutable std::atomic<const Sampling *> sampling;     // Resolved together with the level, nullptr for every call
+        mutable std::atomic<const Sampling *> own_sampling; // Set by the sampled decorators, wins over patterns
+        mutable std::atomic<uint64_t> seen;                 // Calls that went through sampling
+        mutable std::atomic<uint64_t> written;              // Calls that went through sampling and were written
+        mutable std::atomic<int64_t> bucket;                // Token bucket, the time in ns it is full again
+
+        // Constant, so a static site costs no guard and no constructor call
+        constexpr CallSite(const char *func, const char *file, const char *args, int line)
+            : func_name(func),
+              file_name(file),
+              args_name(args),
+              line_no(line),
+              id(0),
+              level(0),
+              sampling(nullptr),
+              own_sampling(nullptr),
+              seen(0),
+              written(0),
+              bucket(0)
+        {
+        }
+
+        constexpr CallSite()
+            : CallSite(nullptr, nullptr, nullptr, 0)
+        {
+        }
+    };
+
+    namespace detail
+    {
+        // Runtime levels and sampling overridden for files or functions
+        // Sites cache what they resolve to, every change starts a new generation
+        class SiteConfig
+        {
+        private:
+            struct Override
+            {
+                std::string pattern;
+                int level;
+                const Sampling *sampling; // nullptr for a level override
+            };
+
+            std::mutex _mutex;
+            std::vector<Override> _overrides;
+            std::vector<std::unique_ptr<Sampling>> _policies; // Kept alive, sites may still point to them
+            const Sampling *_sampling;
+            std::atomic<uint32_t> _generation;
+
+            static bool matches(const CallSite &site, const std::string &pattern)
+            {
+                return (site.file_name != nullptr && std::strstr(site.file_name, pattern.c_str()) != nullptr) ||
+                       (site.func_name != nullptr && std::strncmp(site.func_name, pattern.c_str(), pattern.size()) == 0);
+            }
+
+        public:
+            SiteConfig()
+                : _sampling(nullptr),
+                  _generation(1)
+            {
+            }
+
+            uint32_t generation() const
+            {
+                return _generation.load(std::memory_order_acquire);
+            }
+
+            void touch()
+            {
+                _generation.fetch_add(1, std::memory_order_release);
+            }
+
+            void set(int level)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                globalLevel().store(level, std::memory_order_relaxed);
+                touch();
+            }
+
+            void set(const char *pattern, int level)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _overrides.push_back(Override{pattern, level, nullptr});
+                touch();
+            }
+
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _overrides.erase(std::remove_if(_overrides.begin(), _overrides.end(),
+                                                [](const Override &item) { return item.sampling == nullptr; }),
+                                 _overrides.end());
+                touch();
+            }
+
+            const Sampling *keep(const Sampling &sampling)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _policies.emplace_back(new Sampling(sampling));
+                return _policies.back().get();
+            }
+
+            void sample(const Sampling *sampling)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _sampling = sampling;
+                touch();
+            }
+
+            void sample(const char *pattern, const Sampling *sampling)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _overrides.push_back(Override{pattern, 0, sampling});
+                touch();
+            }
+
+            void clearSampling()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _overrides.erase(std::remove_if(_overrides.begin(), _overrides.end(),
+                                                [](const Override &item) { return item.sampling != nullptr; }),
+                                 _overrides.end());
+                _sampling = nullptr;
+                touch();
+            }
+
+            // The last override matching the file path or the start of the function name wins
+            int resolve(const CallSite &site, const Sampling *&sampling)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                int level = globalLevel().load(std::memory_order_relaxed);
+                sampling = _sampling;
+                for (const Override &item : _overrides)
+                {
+                    if (!matches(site, item.pattern))
+                        continue;
+                    if (item.sampling == nullptr)
+                        level = item.level;
+                    else
+                        sampling = item.sampling;
+                }
+                const Sampling *own = site.own_sampling.load(std::memory_order_relaxed);
+                if (own != nullptr)
+                    sampling = own;
+                if (sampling != nullptr && sampling->one_in <= 1 && sampling->per_second == 0 &&
+                    sampling->slower_than_ns <= 0)
+                    sampling = nullptr;
+                return level;
+            }
+        };
+
+        inline SiteConfig &siteConfig()
+        {
+            static SiteConfig config;
+            return config;
+        }
+    }
+
+    // Lowest level written by every call site without an override
+    inline void setLevel(CPLErr level)
+    {
+        detail::siteConfig().set(static_cast<int>(level));
+    }
+
+    // Override the level of call sites whose file path contains pattern or whose function name starts with it
+    inline void setLevel(const char *pattern, CPLErr level)
+    {
+        detail::siteConfig().set(pattern, static_cast<int>(level));
+    }
+
+    inline void clearLevels()
+    {
+        detail::siteConfig().clear();
+    }
+
+    // Sampling of every call site without an override
+    inline void setSampling(const Sampling &sampling)
+    {
+        detail::SiteConfig &config = detail::siteConfig();
+        config.sample(config.keep(sampling));
+    }
+
+    // Override the sampling of call sites matched like setLevel
+    inline void setSampling(const char *pattern, const Sampling &sampling)
+    {
+        detail::SiteConfig &config = detail::siteConfig();
+        config.sample(pattern, config.keep(sampling));
+    }
+
+    inline void clearSampling()
+    {
+        detail::siteConfig().clearSampling();
+    }
+
+    // Sampling of one site, used by the sampled decorators
+    // Decorating again with the same policy keeps the one already set
+    inline const CallSite &sampleSite(const CallSite &site, const Sampling &sampling)
+    {
+        const Sampling *own = site.own_sampling.load(std::memory_order_relaxed);
+        if (own != nullptr && own->one_in == sampling.one_in && own->per_second == sampling.per_second &&
+            own->slower_than_ns == sampling.slower_than_ns)
+            return site;
+        detail::SiteConfig &config = detail::siteConfig();
+        site.own_sampling.store(config.keep(sampling), std::memory_order_relaxed);
+        config.touch();
+        return site;
+    }
+
+    inline int siteLevel(const CallSite &site)
+    {
+        uint32_t generation = detail::siteConfig().generation();
+        uint32_t cached = site.level.load(std::memory_order_acquire);
+        if ((cached >> 8) == (generation & 0xFFFFFF))
+            return static_cast<int>(cached & 0xFF);
+        const Sampling *sampling = nullptr;
+        int level = detail::siteConfig().resolve(site, sampling);
+        site.sampling.store(sampling, std::memory_order_relaxed);
+        site.level.store(((generation & 0xFFFFFF) << 8) | static_cast<uint32_t>(level), std::memory_order_release);
+        return level;
+    }
+
+    // Sampling of a site, valid once siteLevel resolved it
+    inline const Sampling *siteSampling(const CallSite &site)
+    {
+        return site.sampling.load(std::memory_order_relaxed);
+    }
+
+    inline bool shouldLog(CPLErr level, const CallSite &site)
+    {
+        return static_cast<int>(level) >= SLOG_ACTIVE_LEVEL && static_cast<int>(level) >= siteLevel(site);
+    }
+
+    namespace detail
+    {
+        // Sites that went through sampling, for the suppressed counters
+        class SampledSites
+        {
+        private:
+            std::mutex _mutex;
+            std::vector<const CallSite *> _sites;
+
+        public:
+            void add(const CallSite &site)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _sites.push_back(&site);
+            }
+
+            std::vector<const CallSite *> all()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                return _sites;
+            }
+        };
+
+        inline SampledSites &sampledSites()
+        {
+            static SampledSites sites;
+            return sites;
+        }
+    }
+
+    // Count a call going through sampling, true when one_in lets it through
+    // The only shared write for calls that are sampled out
+    inline bool sampleCount(const CallSite &site, const Sampling &sampling)
+    {
+        uint64_t index = site.seen.fetch_add(1, std::memory_order_relaxed);
+        if (index == 0)
+            detail::sampledSites().add(site);
+        return sampling.one_in <= 1 || index % sampling.one_in == 0;
+    }
+
+    // Take a token from the bucket of a site, the bucket holds one second of calls
+    inline bool sampleRate(const CallSite &site, const Sampling &sampling)
+    {
+        if (sampling.per_second == 0)
+            return true;
+        int64_t interval = 1000000000 / static_cast<int64_t>(sampling.per_second);
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now().time_since_epoch())
+                          .count();
+        int64_t full = site.bucket.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            int64_t base = full > now ? full : now;
+            if (base + interval - now > 1000000000)
+                return false;
+            if (site.bucket.compare_exchange_weak(full, base + interval, std::memory_order_relaxed))
+                return true;
+        }
+    }
+
+    // Calls of a site sampled out since the start
+    inline uint64_t suppressedCalls(const CallSite &site)
+    {
+        return site.seen.load(std::memory_order_relaxed) - site.written.load(std::memory_order_relaxed);
+    }
+
+    // Calls of every site sampled out since the start
+    inline uint64_t suppressedCalls()
+    {
+        uint64_t total = 0;
+        for (const CallSite *site : detail::sampledSites().all())
+            total += suppressedCalls(*site);
+        return total;
+    }
+
+    // Write the suppressed counter of every sampled site through SINFO
+    inline void dumpSampling()
+    {
+        for (const CallSite *site : detail::sampledSites().all())
+        {
+            SLOG_WRITE(CE_Debug, CPLE_None, "  [Sampled]\t%s suppressed %llu of %llu calls",
+                       site->func_name,
+                       static_cast<unsigned long long>(suppressedCalls(*site)),
+                       static_cast<unsigned long long>(site->seen.load(std::memory_order_relaxed)));
+        }
+    }
+
+    // What happened at a call site
+    enum class EventKind : uint8_t
+    {
+        Call = 1,    // A decorated function is entered, message: captured values or nullptr, value: ns queued
+        Action = 2,  // SENTRY, SACTION or a failed argument check is reached
+        Success = 3, // value: duration in nanoseconds
+        Failure = 4, // message: exception text
+        Invalid = 5, // message: name of the NaN argument
+        Fatal = 6    // Unknown exception
+    };
+
+    struct Event
+    {
+        EventKind kind;
+        const CallSite *site;
+        int64_t time; // Wall clock, nanoseconds since the epoch
+        int64_t value;
+        const char *message;
+        ToNsFn to_ns; // Converts a duration in clock ticks, nullptr when value is in nanoseconds
+    };
+
+    // Kinds whose message is kept in the binary log
+    inline bool eventHasMessage(EventKind kind)
+    {
+        return kind == EventKind::Call || kind == EventKind::Success || kind == EventKind::Failure ||
+               kind == EventKind::Invalid;
+    }
+
+    inline int64_t eventNs(const Event &event)
+    {
+        return event.to_ns != nullptr ? event.to_ns(event.value) : event.value;
+    }
+
+    inline CPLErr eventLevel(EventKind kind)
+    {
+        switch (kind)
+        {
+        case EventKind::Failure:
+        case EventKind::Invalid:
+            return CE_Failure;
+        case EventKind::Fatal:
+            return CE_Fatal;
+        default:
+            return CE_Debug;
+        }
+    }
+
+    inline int eventErrNo(EventKind kind)
+    {
+        switch (kind)
+        {
+        case EventKind::Failure:
+        case EventKind::Fatal:
+            return CPLE_AppDefined;
+        case EventKind::Invalid:
+            return CPLE_NotSupported;
+        default:
+            return CPLE_None;
+        }
+    }
+
+    // Text layout of an event, OUT is called like SINFO once per line
+    template <typename OUT>
+    void renderEvent(OUT &&out, const Event &event)
+    {
+        const CallSite &site = *event.site;
+        CPLErr level = eventLevel(event.kind);
+        int err_no = eventErrNo(event.kind);
+        char time_str[SLOG_TIME_BUFFER_SIZE];
+        switch (event.kind)
+        {
+        case EventKind::Call:
+            formatTime(time_str, sizeof(time_str), event.time);
+            out(level, err_no, SLOG_FORMAT("~ %s"), time_str);
+            out(level, err_no, SLOG_FORMAT("  [Function]\t%s(%s)"), site.func_name, site.args_name);
+            out(level, err_no, SLOG_FORMAT("  [Location]\t%s (%d)"), site.file_name, site.line_no);
+            if (event.message != nullptr)
+                out(level, err_no, SLOG_FORMAT("  [Values]\t%s"), event.message);
+            if (event.value > 0)
+                out(level, err_no, SLOG_FORMAT("  [Queued]\tIt waits %lf ms"), static_cast<double>(event.value) / 1e6);
+            break;
+        case EventKind::Action:
+            formatTime(time_str, sizeof(time_str), event.time);
+            out(level, err_no, SLOG_FORMAT("- %s"), time_str);
+            out(level, err_no, SLOG_FORMAT("  [Function]\t%s"), site.func_name);
+            out(level, err_no, SLOG_FORMAT("  [Location]\t%s (%d)"), site.file_name, site.line_no);
+            break;
+        case EventKind::Success:
+            out(level, err_no, SLOG_FORMAT("  [Success]\tIt takes %lf ms"), static_cast<double>(eventNs(event)) / 1e6);
+            if (event.message != nullptr)
+                out(level, err_no, SLOG_FORMAT("  [Counters]\t%s"), event.message);
+            break;
+        case EventKind::Failure:
+            out(level, err_no, SLOG_FORMAT("  [Failure]\t%s"), event.message);
+            break;
+        case EventKind::Invalid:
+            out(level, err_no, SLOG_FORMAT("  [Failure]\tArgument \'%s\' is NaN"), event.message);
+            break;
+        case EventKind::Fatal:
+            out(level, err_no, SLOG_FORMAT("  [Fatal]\t%s"), "Unknown exception");
+            break;
+        }
+    }
+
+    namespace detail
+    {
+        // Events of one record as they are queued for the consumer thread, messages follow as strings
+        struct PackedEvents
+        {
+            const CallSite *site;
+            int64_t time[2];
+            int64_t value[2];
+            ToNsFn to_ns[2];
+            EventKind kind[2];
+            uint8_t count;
+        };
+
+        // Joins the lines of renderEvent, counts like snprintf what does not fit
+        struct LineWriter
+        {
+            char *out;
+            size_t size;
+            size_t len;
+
+            template <typename FMT, typename... ARGS>
+            void operator()(CPLErr /* level */, int /* err_no */, FMT format, const ARGS &...args)
+            {
+                if (len > 0)
+                {
+                    if (len < size)
+                        out[len] = '\n';
+                    ++len;
+                }
+                int done = formatTo(len < size ? out + len : nullptr, len < size ? size - len : 0, format, args...);
+                len += done > 0 ? static_cast<size_t>(done) : 0;
+            }
+        };
+
+        // RenderFn of queued events
+        inline int renderEvents(char *out, size_t size, const char * /* fmt */, const unsigned char *payload)
+        {
+            PackedEvents packed = ArgPacker<PackedEvents>::unpack(payload, 0);
+            LineWriter writer = {out, size, 0};
+            for (uint8_t i = 0; i < packed.count; ++i)
+            {
+                const char *message = ArgPacker<const char *>::unpack(
+                    payload, packedOffset<PackedEvents, const char *, const char *>(1 + i));
+                renderEvent(writer, Event{packed.kind[i], packed.site, packed.time[i], packed.value[i],
+                                          message, packed.to_ns[i]});
+            }
+            return static_cast<int>(writer.len);
+        }
+    }
+
+#define SLOG_BINARY_MAGIC "SLOGBIN1"
+#define SLOG_BINARY_VERSION 3
+#define SLOG_BINARY_ORDER 0x01020304 // Written in native byte order
+
+    // Records of the binary log following the file header
+    // Site:  tag, uint32 id, int32 line, string func, string file, string args
+    // Event: tag, uint8 kind, uint32 site id, int64 time, int64 value[, string message when eventHasMessage]
+    // Strings are an uint16 length and the bytes, length 0xFFFF is nullptr
+    enum class BinaryTag : uint8_t
+    {
+        Site = 1,
+        Event = 2
+    };
+
+    namespace detail
+    {
+        struct ByteWriter
+        {
+            char *data;
+            size_t size;
+            size_t len;
+            template <typename T>
+            void put(const T &value)
+            {
+                if (len + sizeof(T) <= size)
+                    std::memcpy(data + len, &value, sizeof(T));
+                len += sizeof(T);
+            }
+            void putString(const char *str)
+            {
+                uint16_t n = 0xFFFF;
+                if (str != nullptr)
+                    n = static_cast<uint16_t>(
+                        std::min<size_t>({std::strlen(str), 0xFFFE, size > len + 2 ? size - len - 2 : 0}));
+                put(n);
+                if (str != nullptr && len + n <= size)
+                    std::memcpy(data + len, str, n);
+                len += (str != nullptr ? n : 0);
+            }
+        };
+
+        inline std::atomic<uint32_t> &siteCounter()
+        {
+            static std::atomic<uint32_t> counter(0);
+            return counter;
+        }
+    }
+
+    // Process-wide id of a call site, assigned on first use
+    inline uint32_t siteId(const CallSite &site)
+    {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0)
+        {
+            uint32_t fresh = detail::siteCounter().fetch_add(1) + 1;
+            if (site.id.compare_exchange_strong(id, fresh))
+                id = fresh;
+        }
+        return id;
+    }
+
+    namespace detail
+    {
+        // An event of a call site into the flight recorder, whatever the level
+        inline void flightEvent(FlightMap &map, EventKind kind, const CallSite &site, int64_t time, int64_t value,
+                                const char *text = nullptr)
+        {
+            uint32_t id = siteId(site);
+            map.define(id, site.func_name, site.file_name, site.args_name, site.line_no);
+            map.record(static_cast<uint8_t>(kind), id, time, value, eventLevel(kind), text);
+        }
+    }
+
+    // Binary output, formatting is deferred to slog_decode
+    // Every call site is written once as a Site record, events only carry its id and numbers
+    class BinaryLog
+    {
+    private:
+        std::mutex _mutex;
+        FILE *_file;
+        std::vector<bool> _defined; // Site ids already written to the current file
+        std::atomic<bool> _enabled;
+
+        void define(const CallSite &site, uint32_t id)
+        {
+            if (id < _defined.size() && _defined[id])
+                return;
+            if (id >= _defined.size())
+                _defined.resize(id + 1, false);
+            _defined[id] = true;
+            // Sized from the strings, most sites fit on the stack
+            size_t size = sizeof(BinaryTag::Site) + sizeof(id) + sizeof(int32_t) + 3 * sizeof(uint16_t);
+            for (const char *str : {site.func_name, site.file_name, site.args_name})
+                size += str != nullptr ? std::min<size_t>(std::strlen(str), 0xFFFE) : 0;
+            char local[1024];
+            std::vector<char> heap;
+            if (size > sizeof(local))
+                heap.resize(size);
+            detail::ByteWriter out = {heap.empty() ? local : heap.data(), size, 0};
+            out.put(BinaryTag::Site);
+            out.put(id);
+            out.put(static_cast<int32_t>(site.line_no));
+            out.putString(site.func_name);
+            out.putString(site.file_name);
+            out.putString(site.args_name);
+            fwrite(out.data, 1, out.len, _file);
+        }
+
+    public:
+        BinaryLog()
+            : _file(nullptr),
+              _enabled(false)
+        {
+        }
+        ~BinaryLog()
+        {
+            close();
+        }
+        BinaryLog(const BinaryLog &) = delete;
+        BinaryLog &operator=(const BinaryLog &) = delete;
+
+        bool open(const char *path)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_file != nullptr)
+                fclose(_file);
+            _defined.clear();
+            _file = fopen(path, "wb");
+            if (_file == nullptr)
+            {
+                _enabled.store(false);
+                return false;
+            }
+            setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+            const uint32_t order = SLOG_BINARY_ORDER;
+            const uint32_t version = SLOG_BINARY_VERSION;
+            fwrite(SLOG_BINARY_MAGIC, 1, 8, _file);
+            fwrite(&order, sizeof(order), 1, _file);
+            fwrite(&version, sizeof(version), 1, _file);
+            _enabled.store(true);
+            return true;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _enabled.store(false);
+            if (_file != nullptr)
+                fclose(_file);
+            _file = nullptr;
+        }
+
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_file != nullptr)
+                fflush(_file);
+        }
+
+        bool enabled() const
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        void write(const Event &event)
+        {
+            char buffer[1024];
+            uint32_t id = siteId(*event.site);
+            detail::ByteWriter out = {buffer, sizeof(buffer), 0};
+            out.put(BinaryTag::Event);
+            out.put(event.kind);
+            out.put(id);
+            out.put(event.time);
+            out.put(eventNs(event));
+            if (eventHasMessage(event.kind))
+                out.putString(event.message);
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_file == nullptr)
+                return;
+            define(*event.site, id);
+            fwrite(buffer, 1, out.len, _file);
+        }
+    };
+
+    inline BinaryLog &binaryLog()
+    {
+        static BinaryLog log;
+        return log;
+    }
+
+    // Write events of the decorators into a binary file instead of text
+    inline bool openBinaryLog(const char *path)
+    {
+        return binaryLog().open(path);
+    }
+
+    // Close the binary file and go back to text output
+    inline void closeBinaryLog()
+    {
+        binaryLog().close();
+    }
+
+    // Write events of one site as one record, with a single write or a single async slot
+    // At most two events, the entry of a call and how it ended
+    inline void emit(const Event *events, size_t count)
+    {
+        bool fatal = events[count - 1].kind == EventKind::Fatal;
+        if (binaryLog().enabled())
+        {
+            for (size_t i = 0; i < count; ++i)
+                binaryLog().write(events[i]);
+            if (fatal)
+            {
+                binaryLog().flush();
+                exit(1);
+            }
+            return;
+        }
+        CPLErr level = eventLevel(events[count - 1].kind);
+        int err_no = eventErrNo(events[count - 1].kind);
+        detail::PackedEvents packed = {};
+        packed.site = events[0].site;
+        packed.count = static_cast<uint8_t>(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            packed.kind[i] = events[i].kind;
+            packed.time[i] = events[i].time;
+            packed.value[i] = events[i].value;
+            packed.to_ns[i] = events[i].to_ns;
+        }
+        if (!asyncLogger().enqueue(level, err_no, nullptr, &detail::renderEvents, packed,
+                                   events[0].message, count > 1 ? events[1].message : nullptr))
+        {
+            detail::RecordBuffer &record = detail::recordBuffer();
+            record.clear();
+            for (size_t i = 0; i < count; ++i)
+                renderEvent([&record](CPLErr line_level, int line_err_no, auto format, const auto &...args)
+                            { record.line(line_level, line_err_no, format, args...); },
+                            events[i]);
+            detail::writeRecord(level, err_no, record.data(), record.size());
+        }
+        if (fatal)
+        {
+            flush();
+            exit(1);
+        }
+    }
+
+    inline void emit(const Event &event)
+    {
+        emit(&event, 1);
+    }
+
+    inline void logEvent(EventKind kind, const CallSite &site, int64_t value = 0, const char *message = nullptr)
+    {
+        emit(Event{kind, &site, wallTime(), value, message, nullptr});
+    }
+}
+
+#ifndef SLOG_COUNTERS
+#define SLOG_COUNTERS 6 // Performance counters read around one call at most
+#endif
+
+namespace slog
+{
+    // Counters of the calling thread, user space only, read with perf_event_open on Linux
+    enum class Counter : uint8_t
+    {
+        Cycles,
+        Instructions,
+        CacheReferences,
+        CacheMisses,
+        BranchInstructions,
+        BranchMisses,
+        TaskClock, // Software counters from here on, ns of CPU time
+        ContextSwitches,
+        PageFaults
+    };
+
+    inline const char *counterName(Counter counter)
+    {
+        static const char *names[] = {"cycles", "instructions", "cache-references", "cache-misses",
+                                      "branches", "branch-misses", "task-clock", "context-switches",
+                                      "page-faults"};
+        return names[static_cast<int>(counter)];
+    }
+
+    namespace detail
+    {
+        // Counters in use, replaced as a whole and kept until exit so readers need no lock
+        struct CounterConfig
+        {
+            uint8_t count;
+            Counter kinds[SLOG_COUNTERS];
+        };
+
+        // Counters at the start of a call, then their change over it
+        struct CounterSample
+        {
+            const CounterConfig *config; // nullptr when the call is not counted
+            uint64_t value[SLOG_COUNTERS];
+        };
+
+        inline std::atomic<const CounterConfig *> &counterConfig()
+        {
+            static std::atomic<const CounterConfig *> config(nullptr);
+            return config;
+        }
+
+#ifdef __linux__
+        inline int openCounter(Counter counter, int group)
+        {
+            static const uint64_t configs[] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                               PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+                                               PERF_COUNT_HW_BRANCH_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                               PERF_COUNT_SW_TASK_CLOCK, PERF_COUNT_SW_CONTEXT_SWITCHES,
+                                               PERF_COUNT_SW_PAGE_FAULTS};
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = counter < Counter::TaskClock ? PERF_TYPE_HARDWARE : PERF_TYPE_SOFTWARE;
+            attr.config = configs[static_cast<int>(counter)];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = counter < Counter::TaskClock; // Software events such as faults happen in the kernel
+            attr.exclude_hv = 1;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        // Reads a counter scheduled on this CPU without entering the kernel
+        inline bool readMapped(const volatile perf_event_mmap_page *page, uint64_t &value)
+        {
+            uint32_t seq;
+            do
+            {
+                seq = page->lock;
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+                uint32_t index = page->index;
+                if (!page->cap_user_rdpmc || index == 0)
+                    return false;
+                uint32_t low, high;
+                __asm__ volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+                int64_t pmc = static_cast<int64_t>(static_cast<uint64_t>(high) << 32 | low);
+                int shift = 64 - page->pmc_width;
+                pmc = static_cast<int64_t>(static_cast<uint64_t>(pmc) << shift) >> shift;
+                value = static_cast<uint64_t>(page->offset + pmc);
+                std::atomic_signal_fence(std::memory_order_seq_cst);
+            } while (page->lock != seq);
+            return true;
+        }
+#else
+        inline bool readMapped(const volatile perf_event_mmap_page *, uint64_t &)
+        {
+            return false;
+        }
+#endif
+#endif
+
+        // Counters of one thread in one group, opened again when the configuration changes
+        // rdpmc is used while every counter allows it, otherwise one read of the whole group
+        class ThreadCounters
+        {
+        private:
+            const CounterConfig *_config;
+            int _fds[SLOG_COUNTERS];
+            int _slots[SLOG_COUNTERS]; // Position in the group read, -1 when the counter did not open
+            void *_pages[SLOG_COUNTERS];
+            int _leader;
+            int _members;
+            bool _mapped; // Every counter has its page, try rdpmc first
+
+            void close()
+            {
+#ifdef __linux__
+                for (int i = 0; _config != nullptr && i < _config->count; ++i)
+                {
+                    if (_pages[i] != nullptr)
+                        munmap(_pages[i], static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+                    if (_fds[i] >= 0)
+                        ::close(_fds[i]);
+                }
+#endif
+                _config = nullptr;
+                _leader = -1;
+                _members = 0;
+                _mapped = false;
+            }
+
+            void open(const CounterConfig *config)
+            {
+                close();
+                _config = config;
+#ifdef __linux__
+                _mapped = true;
+                for (int i = 0; i < config->count; ++i)
+                {
+                    _fds[i] = openCounter(config->kinds[i], _leader);
+                    _slots[i] = _fds[i] >= 0 ? _members++ : -1;
+                    _pages[i] = nullptr;
+                    if (_fds[i] >= 0 && _leader < 0)
+                        _leader = _fds[i];
+                    if (_fds[i] >= 0 && config->kinds[i] < Counter::TaskClock)
+                    {
+                        void *page = mmap(nullptr, static_cast<size_t>(sysconf(_SC_PAGESIZE)), PROT_READ, MAP_SHARED,
+                                          _fds[i], 0);
+                        _pages[i] = page != MAP_FAILED ? page : nullptr;
+                    }
+                    _mapped = _mapped && _pages[i] != nullptr;
+                }
+#endif
+            }
+
+            void read(uint64_t *values)
+            {
+                for (int i = 0; i < _config->count; ++i)
+                    values[i] = 0;
+#ifdef __linux__
+                if (_mapped)
+                {
+                    int done = 0;
+                    for (; done < _config->count; ++done)
+                    {
+                        if (!readMapped(static_cast<const volatile perf_event_mmap_page *>(_pages[done]), values[done]))
+                            break;
+                    }
+                    if (done == _config->count)
+                        return;
+                }
+                uint64_t group[SLOG_COUNTERS + 1];
+                if (_leader < 0 || ::read(_leader, group, sizeof(group)) < static_cast<ssize_t>(sizeof(uint64_t)))
+                    return;
+                for (int i = 0; i < _config->count; ++i)
+                {
+                    if (_slots[i] >= 0 && static_cast<uint64_t>(_slots[i]) < group[0])
+                        values[i] = group[1 + _slots[i]];
+                }
+#endif
+            }
+
+        public:
+            ThreadCounters()
+                : _config(nullptr),
+                  _leader(-1),
+                  _members(0),
+                  _mapped(false)
+            {
+            }
+            ~ThreadCounters()
+            {
+                close();
+            }
+            ThreadCounters(const ThreadCounters &) = delete;
+            ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+            void start(CounterSample &sample)
+            {
+                const CounterConfig *config = counterConfig().load(std::memory_order_acquire);
+                sample.config = config;
+                if (config == nullptr)
+                    return;
+                if (config != _config)
+                    open(config);
+                read(sample.value);
+            }
+
+            // Leaves the change since start, a configuration changed meanwhile drops the sample
+            void stop(CounterSample &sample)
+            {
+                if (sample.config == nullptr)
+                    return;
+                if (sample.config != _config)
+                {
+                    sample.config = nullptr;
+                    return;
+                }
+                uint64_t now[SLOG_COUNTERS];
+                read(now);
+                for (int i = 0; i < _config->count; ++i)
+                    sample.value[i] = now[i] - sample.value[i];
+            }
+        };
+
+        inline ThreadCounters &threadCounters()
+        {
+            thread_local ThreadCounters counters;
+            return counters;
+        }
+
+        inline std::mutex &counterMutex()
+        {
+            static std::mutex mutex;
+            return mutex;
+        }
+    }
+
+    inline bool countingCalls()
+    {
+        return detail::counterConfig().load(std::memory_order_relaxed) != nullptr;
+    }
+
+    // Count these around every timed call, written with its duration and summed per call site
+    // Counters that can not be opened here are left out, without any hardware counter the software
+    // ones are used instead; returns the counters in use, empty for wall time only
+    inline std::vector<Counter> setCounters(const std::vector<Counter> &counters)
+    {
+        std::lock_guard<std::mutex> lock(detail::counterMutex());
+        static std::vector<std::unique_ptr<detail::CounterConfig>> configs; // Threads may still read old ones
+        std::vector<Counter> active;
+#ifdef __linux__
+        auto usable = [](Counter counter)
+        {
+            int fd = detail::openCounter(counter, -1);
+            if (fd < 0)
+                return false;
+            ::close(fd);
+            return true;
+        };
+        bool hardware = false;
+        for (Counter counter : counters)
+        {
+            if (active.size() < SLOG_COUNTERS && std::find(active.begin(), active.end(), counter) == active.end() &&
+                usable(counter))
+            {
+                active.push_back(counter);
+                hardware = hardware || counter < Counter::TaskClock;
+            }
+        }
+        if (!hardware && std::any_of(counters.begin(), counters.end(), [](Counter counter)
+                                     { return counter < Counter::TaskClock; }))
+        {
+            for (Counter counter : {Counter::TaskClock, Counter::ContextSwitches, Counter::PageFaults})
+            {
+                if (active.size() < SLOG_COUNTERS && std::find(active.begin(), active.end(), counter) == active.end() &&
+                    usable(counter))
+                    active.push_back(counter);
+            }
+        }
+#endif
+        if (active.empty())
+        {
+            detail::counterConfig().store(nullptr, std::memory_order_release);
+            return active;
+        }
+        std::unique_ptr<detail::CounterConfig> config(new detail::CounterConfig());
+        config->count = static_cast<uint8_t>(active.size());
+        std::copy(active.begin(), active.end(), config->kinds);
+        detail::counterConfig().store(config.get(), std::memory_order_release);
+        configs.push_back(std::move(config));
+        return active;
+    }
+}
+
+namespace slog
+{
+    namespace detail
+    {
+        // Heap use of one thread, only touched by the allocation hooks of that thread
+        // Plain integers with no constructor, so reading them never allocates or takes a lock
+        struct ThreadAllocations
+        {
+            uint64_t count;
+            uint64_t allocated; // Bytes as reported by the allocator, including its rounding
+            uint64_t freed;
+            int64_t net; // Can go below zero when memory of other threads is freed here
+            int64_t peak;
+            uint32_t depth; // Tracked calls running, nothing is counted outside of them
+        };
+
+        inline ThreadAllocations &threadAllocations()
+        {
+            thread_local ThreadAllocations allocations = {0, 0, 0, 0, 0, 0};
+            return allocations;
+        }
+
+        inline std::atomic<bool> &allocationHooks()
+        {
+            static std::atomic<bool> installed(false);
+            return installed;
+        }
+
+        inline std::atomic<bool> &allocationMode()
+        {
+            static std::atomic<bool> enabled(false);
+            return enabled;
+        }
+
+        inline size_t allocationSize(void *ptr)
+        {
+#if defined(_WIN32)
+            return _msize(ptr);
+#elif defined(__APPLE__)
+            return malloc_size(ptr);
+#elif defined(__linux__)
+            return malloc_usable_size(ptr);
+#else
+            return 0;
+#endif
+        }
+
+        // The hooks return before any other work while tracking is off or no tracked call runs
+        inline void countAllocation(void *ptr)
+        {
+            if (ptr == nullptr || !allocationMode().load(std::memory_order_relaxed))
+                return;
+            ThreadAllocations &allocations = threadAllocations();
+            if (allocations.depth == 0)
+                return;
+            size_t size = allocationSize(ptr);
+            ++allocations.count;
+            allocations.allocated += size;
+            allocations.net += static_cast<int64_t>(size);
+            if (allocations.net > allocations.peak)
+                allocations.peak = allocations.net;
+        }
+
+        inline void countFree(void *ptr)
+        {
+            if (ptr == nullptr || !allocationMode().load(std::memory_order_relaxed))
+                return;
+            ThreadAllocations &allocations = threadAllocations();
+            if (allocations.depth == 0)
+                return;
+            size_t size = allocationSize(ptr);
+            allocations.freed += size;
+            allocations.net -= static_cast<int64_t>(size);
+        }
+
+        // Allocations of one call, the thread's peak is restarted for the call and restored after it
+        struct AllocationSample
+        {
+            bool active;
+            uint64_t count;
+            uint64_t allocated;
+            uint64_t freed;
+            int64_t net;  // Thread's net bytes when the call started
+            int64_t peak; // Thread's peak when the call started, then the call's peak above its start
+        };
+
+        inline void startAllocations(AllocationSample &sample)
+        {
+            ThreadAllocations &allocations = threadAllocations();
+            sample.active = true;
+            sample.count = allocations.count;
+            sample.allocated = allocations.allocated;
+            sample.freed = allocations.freed;
+            sample.net = allocations.net;
+            sample.peak = allocations.peak;
+            allocations.peak = allocations.net;
+            ++allocations.depth;
+        }
+
+        inline void stopAllocations(AllocationSample &sample)
+        {
+            ThreadAllocations &allocations = threadAllocations();
+            --allocations.depth;
+            sample.count = allocations.count - sample.count;
+            sample.allocated = allocations.allocated - sample.allocated;
+            sample.freed = allocations.freed - sample.freed;
+            int64_t peak = allocations.peak;
+            allocations.peak = std::max(sample.peak, peak);
+            sample.peak = peak - sample.net;
+        }
+
+        // Measurements of one call as "cycles=1200 instructions=2400 ipc=2.00 allocations=3 ..."
+        inline const char *renderMeasured(const CounterSample &counters, const AllocationSample &allocations)
+        {
+            if (counters.config == nullptr && !allocations.active)
+                return nullptr;
+            thread_local std::string text;
+            text.clear();
+            char item[96];
+            auto append = [&item](int len)
+            {
+                text.append(item, static_cast<size_t>(std::max(0, std::min<int>(len, sizeof(item) - 1))));
+            };
+            uint64_t cycles = 0, instructions = 0;
+            for (int i = 0; counters.config != nullptr && i < counters.config->count; ++i)
+            {
+                Counter kind = counters.config->kinds[i];
+                append(formatTo(item, sizeof(item), SLOG_FORMAT("%s%s=%llu"), text.empty() ? "" : " ",
+                                counterName(kind), static_cast<unsigned long long>(counters.value[i])));
+                if (kind == Counter::Cycles)
+                    cycles = counters.value[i];
+                else if (kind == Counter::Instructions)
+                    instructions = counters.value[i];
+            }
+            if (cycles != 0 && instructions != 0)
+                append(formatTo(item, sizeof(item), SLOG_FORMAT(" ipc=%.2f"),
+                                static_cast<double>(instructions) / static_cast<double>(cycles)));
+            if (allocations.active)
+                append(formatTo(item, sizeof(item), SLOG_FORMAT("%sallocations=%llu allocated=%llu freed=%llu peak=%lld"),
+                                text.empty() ? "" : " ", static_cast<unsigned long long>(allocations.count),
+                                static_cast<unsigned long long>(allocations.allocated),
+                                static_cast<unsigned long long>(allocations.freed),
+                                static_cast<long long>(allocations.peak)));
+            return text.c_str();
+        }
+    }
+
+    // Count heap allocations made during every timed call, written with its duration and summed per call site
+    // Needs the hooks defined by SLOG_ALLOCATION_HOOKS in one source file; returns whether counting is on
+    inline bool setAllocationTracking(bool enable)
+    {
+        enable = enable && detail::allocationHooks().load(std::memory_order_relaxed);
+        detail::allocationMode().store(enable, std::memory_order_relaxed);
+        return enable;
+    }
+
+    inline bool trackingAllocations()
+    {
+        return detail::allocationMode().load(std::memory_order_relaxed);
+    }
+}
+
+#ifndef SLOG_HISTOGRAM_MAX_EXP
+#define SLOG_HISTOGRAM_MAX_EXP 44 // Durations from 2^44 ns (about 4.9 hours) on share the last bucket
+#endif
+
+namespace slog
+{
+    namespace detail
+    {
+        // Log-linear histogram, 8 buckets per power of two, exact below 8 ns
+        const int kHistogramBuckets = (SLOG_HISTOGRAM_MAX_EXP - 2) * 8;
+
+        inline int log2Floor(uint64_t value)
+        {
+#if defined(__GNUC__)
+            return 63 - __builtin_clzll(value);
+#else
+            int bit = 0;
+            while (value >>= 1)
+                ++bit;
+            return bit;
+#endif
+        }
+
+        inline int histogramBucket(uint64_t ns)
+        {
+            if (ns < 8)
+                return static_cast<int>(ns);
+            int exp = log2Floor(ns);
+            if (exp >= SLOG_HISTOGRAM_MAX_EXP)
+                return kHistogramBuckets - 1;
+            return (exp - 2) * 8 + static_cast<int>((ns >> (exp - 3)) & 7);
+        }
+
+        // Smallest duration falling into the bucket
+        inline uint64_t bucketLower(int bucket)
+        {
+            if (bucket < 8)
+                return static_cast<uint64_t>(bucket);
+            int exp = bucket / 8 + 2;
+            return static_cast<uint64_t>(8 + bucket % 8) << (exp - 3);
+        }
+
+        // Duration at quantile q of count calls in the histogram, the middle of its bucket kept within min and max
+        inline uint64_t percentile(const uint64_t *buckets, uint64_t count, double q, uint64_t min, uint64_t max)
+        {
+            uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+            uint64_t seen = 0;
+            for (int i = 0; i < kHistogramBuckets; ++i)
+            {
+                seen += buckets[i];
+                if (seen >= rank)
+                {
+                    uint64_t lower = bucketLower(i);
+                    uint64_t upper = i + 1 < kHistogramBuckets ? bucketLower(i + 1) : max + 1;
+                    uint64_t middle = lower + (upper - lower) / 2;
+                    return std::min(std::max(middle, min), max);
+                }
+            }
+            return max;
+        }
+
+        // Counters of one call site owned by one thread
+        // Only the owner writes, so plain load and store keep them lock-free; readers merge at any time
+        struct SiteShard
+        {
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> failures;
+            std::atomic<uint64_t> total;
+            std::atomic<uint64_t> min;
+            std::atomic<uint64_t> max;
+            std::atomic<uint64_t> buckets[kHistogramBuckets];
+            std::atomic<const CounterConfig *> counter_config; // Counters summed below, restarted when it changes
+            std::atomic<uint64_t> counted;
+            std::atomic<uint64_t> counters[SLOG_COUNTERS];
+            std::atomic<uint64_t> tracked; // Calls with their allocations counted
+            std::atomic<uint64_t> allocations;
+            std::atomic<uint64_t> allocated;
+            std::atomic<uint64_t> freed;
+            std::atomic<uint64_t> peak; // Highest peak of one call
+
+            SiteShard()
+                : count(0),
+                  failures(0),
+                  total(0),
+                  min(std::numeric_limits<uint64_t>::max()),
+                  max(0),
+                  counter_config(nullptr),
+                  counted(0),
+                  tracked(0),
+                  allocations(0),
+                  allocated(0),
+                  freed(0),
+                  peak(0)
+            {
+                for (int i = 0; i < kHistogramBuckets; ++i)
+                    buckets[i].store(0, std::memory_order_relaxed);
+                for (int i = 0; i < SLOG_COUNTERS; ++i)
+                    counters[i].store(0, std::memory_order_relaxed);
+            }
+
+            static void bump(std::atomic<uint64_t> &counter, uint64_t value)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+
+            void record(uint64_t ns)
+            {
+                bump(count, 1);
+                bump(total, ns);
+                bump(buckets[histogramBucket(ns)], 1);
+                if (ns < min.load(std::memory_order_relaxed))
+                    min.store(ns, std::memory_order_relaxed);
+                if (ns > max.load(std::memory_order_relaxed))
+                    max.store(ns, std::memory_order_relaxed);
+            }
+
+            void fail()
+            {
+                bump(count, 1);
+                bump(failures, 1);
+            }
+
+            void record(const CounterSample &sample)
+            {
+                if (sample.config == nullptr)
+                    return;
+                if (sample.config != counter_config.load(std::memory_order_relaxed))
+                {
+                    counted.store(0, std::memory_order_relaxed);
+                    for (int i = 0; i < SLOG_COUNTERS; ++i)
+                        counters[i].store(0, std::memory_order_relaxed);
+                    counter_config.store(sample.config, std::memory_order_release);
+                }
+                bump(counted, 1);
+                for (int i = 0; i < sample.config->count; ++i)
+                    bump(counters[i], sample.value[i]);
+            }
+
+            void record(const AllocationSample &sample)
+            {
+                if (!sample.active)
+                    return;
+                bump(tracked, 1);
+                bump(allocations, sample.count);
+                bump(allocated, sample.allocated);
+                bump(freed, sample.freed);
+                if (sample.peak > 0 && static_cast<uint64_t>(sample.peak) > peak.load(std::memory_order_relaxed))
+                    peak.store(static_cast<uint64_t>(sample.peak), std::memory_order_relaxed);
+            }
+        };
+
+        inline std::atomic<bool> &aggregateMode()
+        {
+            static std::atomic<bool> enabled(false);
+            return enabled;
+        }
+    }
+
+    // Merged counters of one call site, durations in nanoseconds
+    struct SiteStats
+    {
+        const CallSite *site;
+        uint64_t count; // Calls, including failures
+        uint64_t failures;
+        uint64_t total; // Sum over successful calls
+        uint64_t min;
+        uint64_t max;
+        uint64_t p50;
+        uint64_t p90;
+        uint64_t p99;
+        uint64_t p999;
+        uint64_t counted;                // Calls measured with the counters given to setCounters
+        uint64_t counters[SLOG_COUNTERS]; // Sums over those calls, in the order setCounters returned
+        uint64_t tracked;                 // Calls with their allocations counted
+        uint64_t allocations;             // Sums over those calls
+        uint64_t allocated;               // Bytes
+        uint64_t freed;
+        uint64_t peak; // Highest net bytes above the start of one call
+    };
+
+    // Owns the shards of every thread so they outlive the threads that filled them
+    class StatsRegistry
+    {
+    private:
+        struct Entry
+        {
+            const CallSite *site;
+            std::vector<std::unique_ptr<detail::SiteShard>> shards;
+        };
+
+        std::mutex _mutex;
+        std::vector<Entry> _entries; // Indexed by site id
+
+        static uint64_t percentile(const std::vector<uint64_t> &buckets, uint64_t count,
+                                   double q, uint64_t min, uint64_t max)
+        {
+            return detail::percentile(buckets.data(), count, q, min, max);
+        }
+
+    public:
+        detail::SiteShard *create(const CallSite &site, uint32_t id)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (id >= _entries.size())
+                _entries.resize(id + 1);
+            _entries[id].site = &site;
+            _entries[id].shards.emplace_back(new detail::SiteShard());
+            return _entries[id].shards.back().get();
+        }
+
+        // Histograms of successful calls go to histograms when given, in the order of the result
+        std::vector<SiteStats> collect(std::vector<std::vector<uint64_t>> *histograms = nullptr)
+        {
+            std::vector<SiteStats> result;
+            std::vector<uint64_t> buckets(detail::kHistogramBuckets);
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const Entry &entry : _entries)
+            {
+                if (entry.shards.empty())
+                    continue;
+                SiteStats stats = {entry.site, 0, 0, 0, std::numeric_limits<uint64_t>::max(), 0, 0, 0, 0, 0, 0, {},
+                                   0, 0, 0, 0, 0};
+                std::fill(buckets.begin(), buckets.end(), 0);
+                const detail::CounterConfig *config = detail::counterConfig().load(std::memory_order_acquire);
+                for (const auto &shard : entry.shards)
+                {
+                    stats.count += shard->count.load(std::memory_order_relaxed);
+                    stats.failures += shard->failures.load(std::memory_order_relaxed);
+                    stats.total += shard->total.load(std::memory_order_relaxed);
+                    stats.min = std::min(stats.min, shard->min.load(std::memory_order_relaxed));
+                    stats.max = std::max(stats.max, shard->max.load(std::memory_order_relaxed));
+                    for (int i = 0; i < detail::kHistogramBuckets; ++i)
+                        buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+                    stats.tracked += shard->tracked.load(std::memory_order_relaxed);
+                    stats.allocations += shard->allocations.load(std::memory_order_relaxed);
+                    stats.allocated += shard->allocated.load(std::memory_order_relaxed);
+                    stats.freed += shard->freed.load(std::memory_order_relaxed);
+                    stats.peak = std::max(stats.peak, shard->peak.load(std::memory_order_relaxed));
+                    if (config == nullptr || shard->counter_config.load(std::memory_order_acquire) != config)
+                        continue;
+                    stats.counted += shard->counted.load(std::memory_order_relaxed);
+                    for (int i = 0; i < config->count; ++i)
+                        stats.counters[i] += shard->counters[i].load(std::memory_order_relaxed);
+                }
+                uint64_t timed = stats.count - stats.failures;
+                if (timed == 0)
+                    stats.min = 0;
+                else
+                {
+                    stats.p50 = percentile(buckets, timed, 0.5, stats.min, stats.max);
+                    stats.p90 = percentile(buckets, timed, 0.9, stats.min, stats.max);
+                    stats.p99 = percentile(buckets, timed, 0.99, stats.min, stats.max);
+                    stats.p999 = percentile(buckets, timed, 0.999, stats.min, stats.max);
+                }
+                result.push_back(stats);
+                if (histograms != nullptr)
+                    histograms->push_back(buckets);
+            }
+            return result;
+        }
+    };
+
+    inline StatsRegistry &statsRegistry()
+    {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    // Shard of the calling thread for a call site
+    inline detail::SiteShard &siteShard(const CallSite &site)
+    {
+        thread_local std::vector<detail::SiteShard *> shards;
+        uint32_t id = siteId(site);
+        if (id >= shards.size())
+            shards.resize(id + 1, nullptr);
+        if (shards[id] == nullptr)
+            shards[id] = statsRegistry().create(site, id);
+        return *shards[id];
+    }
+
+    // Aggregate timings per call site instead of writing a record per call
+    // Failures are still written, together with the header of their call
+    inline void setAggregate(bool enable)
+    {
+        detail::aggregateMode().store(enable, std::memory_order_relaxed);
+    }
+
+    inline bool aggregating()
+    {
+        return detail::aggregateMode().load(std::memory_order_relaxed);
+    }
+
+    // Merge the shards of all threads, on demand
+    inline std::vector<SiteStats> collectStats()
+    {
+        return statsRegistry().collect();
+    }
+
+    // Write the merged statistics as a table through SINFO, total in ms and the others in us
+    // With counters set or allocations tracked, their average per call follows the times
+    inline void dumpStats()
+    {
+        char time_str[SLOG_TIME_BUFFER_SIZE];
+        formatTime(time_str, sizeof(time_str));
+        std::vector<SiteStats> all = collectStats();
+        const detail::CounterConfig *config = detail::counterConfig().load(std::memory_order_acquire);
+        bool tracking = trackingAllocations();
+        char counters[(SLOG_COUNTERS + 3) * 20 + 1] = "";
+        size_t used = 0;
+        for (int i = 0; config != nullptr && i < config->count; ++i)
+            used += std::snprintf(counters + used, sizeof(counters) - used, " %19.19s", counterName(config->kinds[i]));
+        if (tracking)
+            std::snprintf(counters + used, sizeof(counters) - used, " %12s %12s %12s", "allocs", "alloc(B)", "peak(B)");
+        SLOG_WRITE(CE_Debug, CPLE_None, "= %s", time_str);
+        SLOG_WRITE(CE_Debug, CPLE_None, "  %12s %8s %12s %10s %10s %10s %10s %10s %10s%s  %s",
+              "calls", "failures", "total(ms)", "min(us)", "p50(us)", "p90(us)", "p99(us)", "p999(us)", "max(us)",
+              counters, "function");
+        for (const SiteStats &stats : all)
+        {
+            used = 0;
+            for (int i = 0; config != nullptr && i < config->count; ++i)
+                used += std::snprintf(counters + used, sizeof(counters) - used, " %19.1f",
+                                      stats.counted == 0 ? 0.0 : static_cast<double>(stats.counters[i]) / stats.counted);
+            if (tracking)
+                std::snprintf(counters + used, sizeof(counters) - used, " %12.1f %12.1f %12llu",
+                              stats.tracked == 0 ? 0.0 : static_cast<double>(stats.allocations) / stats.tracked,
+                              stats.tracked == 0 ? 0.0 : static_cast<double>(stats.allocated) / stats.tracked,
+                              static_cast<unsigned long long>(stats.peak));
+            SLOG_WRITE(CE_Debug, CPLE_None, "  %12llu %8llu %12.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f%s  %s (%s:%d)",
+                  static_cast<unsigned long long>(stats.count),
+                  static_cast<unsigned long long>(stats.failures),
+                  stats.total / 1e6, stats.min / 1e3, stats.p50 / 1e3, stats.p90 / 1e3,
+                  stats.p99 / 1e3, stats.p999 / 1e3, stats.max / 1e3, counters,
+                  stats.site->func_name, stats.site->file_name, stats.site->line_no);
+        }
+    }
+
+    // Dump the statistics every interval from a background thread
+    class StatsReporter
+    {
+    private:
+        std::thread _thread;
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        bool _running;
+
+    public:
+        StatsReporter()
+            : _running(false)
+        {
+        }
+        ~StatsReporter()
+        {
+            stop();
+        }
+        void start(std::chrono::milliseconds interval)
+        {
+            stop();
+            _running = true;
+            _thread = std::thread([this, interval]()
+                                  {
+                std::unique_lock<std::mutex> lock(_mutex);
+                while (!_cv.wait_for(lock, interval, [this]() { return !_running; }))
+                {
+                    lock.unlock();
+                    dumpStats();
+                    lock.lock();
+                } });
+        }
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _running = false;
+            }
+            _cv.notify_all();
+            if (_thread.joinable())
+                _thread.join();
+        }
+    };
+
+    inline void startStatsReport(std::chrono::milliseconds interval)
+    {
+        static StatsReporter reporter;
+        reporter.start(interval);
+    }
+
+    // A call site slower than in the baseline
+    struct Regression
+    {
+        const CallSite *site;
+        uint64_t baseline_calls;
+        uint64_t calls;
+        uint64_t baseline_p50; // ns
+        uint64_t p50;
+        uint64_t baseline_p99;
+        uint64_t p99;
+        double distance; // One-sided Kolmogorov-Smirnov statistic of the two duration histograms
+    };
+
+    // When a call site counts as regressed
+    struct RegressionOptions
+    {
+        double threshold; // Relative growth of the median or p99, 0.2 for 20 %
+        double alpha;     // Significance of the test that the durations got longer
+        uint64_t min_calls; // Fewer successful calls than this, in the baseline or now, are not compared
+    };
+
+    namespace detail
+    {
+        // Summary of one call site as saved in a baseline file
+        struct SiteBaseline
+        {
+            uint64_t calls;
+            uint64_t p50;
+            uint64_t p99;
+            std::vector<uint64_t> buckets;
+        };
+
+        struct BaselineState
+        {
+            std::mutex mutex;
+            std::unordered_map<std::string, SiteBaseline> sites; // By "func\tfile\tline"
+            RegressionOptions options = {0.2, 0.01, 100};
+            std::function<void(const Regression &)> callback;
+            std::string path; // Written when the run finishes, empty when not used
+            bool update = false;
+            bool finished = false;
+        };
+
+        inline BaselineState &baselineState()
+        {
+            static BaselineState state;
+            return state;
+        }
+
+        inline std::string baselineKey(const CallSite &site)
+        {
+            char line[16];
+            std::snprintf(line, sizeof(line), "%d", site.line_no);
+            return std::string(site.func_name) + '\t' + site.file_name + '\t' + line;
+        }
+
+        // Largest amount by which the baseline CDF lies above the current one, large when calls got slower
+        inline double slowerDistance(const std::vector<uint64_t> &baseline, uint64_t baseline_calls,
+                                     const std::vector<uint64_t> &current, uint64_t calls)
+        {
+            double distance = 0.0;
+            uint64_t seen_baseline = 0, seen = 0;
+            for (size_t i = 0; i < baseline.size() && i < current.size(); ++i)
+            {
+                seen_baseline += baseline[i];
+                seen += current[i];
+                distance = std::max(distance, static_cast<double>(seen_baseline) / baseline_calls -
+                                                  static_cast<double>(seen) / calls);
+            }
+            return distance;
+        }
+
+        // Compares the live statistics with the baseline, the caller holds the state's lock
+        inline std::vector<Regression> findRegressions(BaselineState &state)
+        {
+            std::vector<Regression> result;
+            std::vector<std::vector<uint64_t>> histograms;
+            std::vector<SiteStats> all = statsRegistry().collect(&histograms);
+            const RegressionOptions &options = state.options;
+            for (size_t i = 0; i < all.size(); ++i)
+            {
+                const SiteStats &stats = all[i];
+                auto it = state.sites.find(baselineKey(*stats.site));
+                uint64_t calls = stats.count - stats.failures;
+                if (it == state.sites.end() || calls < options.min_calls || it->second.calls < options.min_calls)
+                    continue;
+                const SiteBaseline &baseline = it->second;
+                bool slower = stats.p50 > baseline.p50 * (1.0 + options.threshold) ||
+                              stats.p99 > baseline.p99 * (1.0 + options.threshold);
+                if (!slower)
+                    continue;
+                double distance = slowerDistance(baseline.buckets, baseline.calls, histograms[i], calls);
+                double n = static_cast<double>(baseline.calls), m = static_cast<double>(calls);
+                if (distance <= std::sqrt(-0.5 * std::log(options.alpha)) * std::sqrt((n + m) / (n * m)))
+                    continue;
+                result.push_back(Regression{stats.site, baseline.calls, calls, baseline.p50, stats.p50, baseline.p99,
+                                            stats.p99, distance});
+            }
+            return result;
+        }
+    }
+
+    inline void setRegressionOptions(const RegressionOptions &options)
+    {
+        std::lock_guard<std::mutex> lock(detail::baselineState().mutex);
+        detail::baselineState().options = options;
+    }
+
+    // Called for every regressed call site found by checkRegressions, in the checking thread
+    inline void setRegressionCallback(std::function<void(const Regression &)> callback)
+    {
+        std::lock_guard<std::mutex> lock(detail::baselineState().mutex);
+        detail::baselineState().callback = std::move(callback);
+    }
+
+    // Summaries of every aggregated call site as one line each: func, file, line, calls, p50, p99 and
+    // the non-empty histogram buckets as index:count, separated by tabs
+    inline bool saveBaseline(const char *path)
+    {
+        std::vector<std::vector<uint64_t>> histograms;
+        std::vector<SiteStats> all = statsRegistry().collect(&histograms);
+        FILE *file = fopen(path, "w");
+        if (file == nullptr)
+            return false;
+        fprintf(file, "# slog baseline 1\n");
+        for (size_t i = 0; i < all.size(); ++i)
+        {
+            const SiteStats &stats = all[i];
+            uint64_t calls = stats.count - stats.failures;
+            if (calls == 0)
+                continue;
+            fprintf(file, "%s\t%s\t%d\t%llu\t%llu\t%llu\t", stats.site->func_name, stats.site->file_name,
+                    stats.site->line_no, static_cast<unsigned long long>(calls),
+                    static_cast<unsigned long long>(stats.p50), static_cast<unsigned long long>(stats.p99));
+            const char *separator = "";
+            for (size_t j = 0; j < histograms[i].size(); ++j)
+            {
+                if (histograms[i][j] == 0)
+                    continue;
+                fprintf(file, "%s%zu:%llu", separator, j, static_cast<unsigned long long>(histograms[i][j]));
+                separator = ",";
+            }
+            fprintf(file, "\n");
+        }
+        return fclose(file) == 0;
+    }
+
+    // Replaces the baseline the live statistics are compared with, false if the file can not be read
+    inline bool loadBaseline(const char *path)
+    {
+        FILE *file = fopen(path, "r");
+        if (file == nullptr)
+            return false;
+        std::unordered_map<std::string, detail::SiteBaseline> sites;
+        std::string line;
+        char chunk[1024];
+        while (fgets(chunk, sizeof(chunk), file) != nullptr)
+        {
+            line += chunk;
+            if (line.back() != '\n' && !feof(file))
+                continue;
+            if (!line.empty() && line.back() == '\n')
+                line.pop_back();
+            std::vector<std::string> fields;
+            for (size_t start = 0;;)
+            {
+                size_t end = line.find('\t', start);
+                fields.push_back(line.substr(start, end - start));
+                if (end == std::string::npos)
+                    break;
+                start = end + 1;
+            }
+            if (line.empty() || line[0] == '#' || fields.size() != 7)
+            {
+                line.clear();
+                continue;
+            }
+            detail::SiteBaseline site;
+            site.calls = std::strtoull(fields[3].c_str(), nullptr, 10);
+            site.p50 = std::strtoull(fields[4].c_str(), nullptr, 10);
+            site.p99 = std::strtoull(fields[5].c_str(), nullptr, 10);
+            site.buckets.assign(detail::kHistogramBuckets, 0);
+            for (const char *item = fields[6].c_str(); *item != '\0';)
+            {
+                char *end;
+                unsigned long long index = std::strtoull(item, &end, 10);
+                if (*end != ':')
+                    break;
+                unsigned long long count = std::strtoull(end + 1, &end, 10);
+                if (index < site.buckets.size())
+                    site.buckets[index] = count;
+                item = *end == ',' ? end + 1 : end;
+            }
+            sites[fields[0] + '\t' + fields[1] + '\t' + fields[2]] = std::move(site);
+            line.clear();
+        }
+        fclose(file);
+        std::lock_guard<std::mutex> lock(detail::baselineState().mutex);
+        detail::baselineState().sites = std::move(sites);
+        return true;
+    }
+
+    namespace detail
+    {
+        // Without report nothing is written through SINFO, as needed at exit when the sinks may be gone
+        inline std::vector<Regression> checkRegressions(bool report)
+        {
+            BaselineState &state = baselineState();
+            std::vector<Regression> found;
+            std::function<void(const Regression &)> callback;
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                found = findRegressions(state);
+                callback = state.callback;
+            }
+            if (report && !found.empty())
+            {
+                char time_str[SLOG_TIME_BUFFER_SIZE];
+                formatTime(time_str, sizeof(time_str));
+                SLOG_WRITE(CE_Warning, CPLE_AppDefined, "! %s", time_str);
+            }
+            for (const Regression &regression : found)
+            {
+                if (report)
+                    SLOG_WRITE(CE_Warning, CPLE_AppDefined, "  [Regressed]\t%s (%s:%d) p50 %.3f -> %.3f us, p99 %.3f -> %.3f us, D = %.3f over %llu calls",
+                          regression.site->func_name, regression.site->file_name, regression.site->line_no,
+                          regression.baseline_p50 / 1e3, regression.p50 / 1e3, regression.baseline_p99 / 1e3,
+                          regression.p99 / 1e3, regression.distance, static_cast<unsigned long long>(regression.calls));
+                if (callback)
+                    callback(regression);
+            }
+            return found;
+        }
+
+        inline std::vector<Regression> finishBaseline(bool report)
+        {
+            BaselineState &state = baselineState();
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (state.path.empty() || state.finished)
+                    return std::vector<Regression>();
+                state.finished = true;
+            }
+            std::vector<Regression> found = checkRegressions(report);
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.update)
+                saveBaseline(state.path.c_str());
+            return found;
+        }
+    }
+
+    // Compares the aggregated statistics with the baseline, writes a report through SINFO and calls the callback
+    inline std::vector<Regression> checkRegressions()
+    {
+        return detail::checkRegressions(true);
+    }
+
+    // Loads the baseline at path if there is one and turns on aggregation; when the run finishes it is
+    // checked against the baseline, then saved as the new one when there was none yet or update is set
+    inline bool useBaseline(const char *path, bool update = false)
+    {
+        detail::BaselineState &state = detail::baselineState();
+        statsRegistry(); // Destroyed after the exit handler below
+        bool loaded = loadBaseline(path);
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            bool registered = !state.path.empty();
+            state.path = path;
+            state.update = update || !loaded;
+            state.finished = false;
+            if (!registered)
+                std::atexit([]()
+                            { detail::finishBaseline(false); });
+        }
+        setAggregate(true);
+        return loaded;
+    }
+
+    // Checks and saves the run given to useBaseline, with its report; without this call it happens at exit,
+    // where only the callback is told
+    inline std::vector<Regression> finishBaseline()
+    {
+        return detail::finishBaseline(true);
+    }
+
+}
+
+#define SLOG_SHARED_MAGIC "SLOGSTA1"
+#define SLOG_SHARED_VERSION 1
+#define SLOG_SHARED_ORDER 0x01020304 // Written in native byte order
+#define SLOG_SHARED_PREFIX "/slog." // Name of the shared memory of a process, followed by its id
+
+namespace slog
+{
+    namespace detail
+    {
+        // Start of the shared statistics of a process, the layout is fixed for readers built apart
+        struct SharedHeader
+        {
+            char magic[8];
+            uint32_t order;
+            uint32_t version;
+            uint32_t sites;
+            uint32_t buckets; // kHistogramBuckets of the writer
+            int32_t pid;
+            uint32_t reserved0;
+            int64_t started; // Wall clock ns when the statistics were opened
+            char reserved[24];
+        };
+
+        // Counters of the call site with the same id, names are valid once state is 2
+        // Every counter is its own atomic, updated without a lock by all threads of the process
+        struct SharedSite
+        {
+            std::atomic<uint32_t> state;
+            int32_t line;
+            char func[64];
+            char file[128];
+            std::atomic<uint64_t> calls; // Including failures
+            std::atomic<uint64_t> failures;
+            std::atomic<uint64_t> total; // ns over successful calls
+            std::atomic<uint64_t> min;
+            std::atomic<uint64_t> max;
+            std::atomic<uint64_t> buckets[kHistogramBuckets];
+        };
+
+        static_assert(sizeof(SharedHeader) == 64, "Unexpected shared statistics header size");
+        static_assert(sizeof(SharedSite) == 240 + kHistogramBuckets * 8, "Unexpected shared statistics site size");
+
+        inline void raiseTo(std::atomic<uint64_t> &counter, uint64_t value)
+        {
+            uint64_t old = counter.load(std::memory_order_relaxed);
+            while (value > old && !counter.compare_exchange_weak(old, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        inline void lowerTo(std::atomic<uint64_t> &counter, uint64_t value)
+        {
+            uint64_t old = counter.load(std::memory_order_relaxed);
+            while (value < old && !counter.compare_exchange_weak(old, value, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        struct SharedMap
+        {
+            SharedHeader *header;
+            SharedSite *sites;
+            void *base;
+            size_t size;
+
+            // Site of a call, its names are written by the first thread; nullptr when the table is full
+            SharedSite *site(const CallSite &site)
+            {
+                uint32_t id = siteId(site);
+                if (id >= header->sites)
+                    return nullptr;
+                SharedSite &shared = sites[id];
+                uint32_t state = shared.state.load(std::memory_order_acquire);
+                if (state == 0 && shared.state.compare_exchange_strong(state, 1, std::memory_order_acquire))
+                {
+                    shared.line = site.line_no;
+                    copyText(shared.func, sizeof(shared.func), site.func_name);
+                    copyText(shared.file, sizeof(shared.file), site.file_name);
+                    shared.state.store(2, std::memory_order_release);
+                }
+                return &shared;
+            }
+
+            void record(const CallSite &site, uint64_t ns)
+            {
+                SharedSite *shared = this->site(site);
+                if (shared == nullptr)
+                    return;
+                shared->calls.fetch_add(1, std::memory_order_relaxed);
+                shared->total.fetch_add(ns, std::memory_order_relaxed);
+                shared->buckets[histogramBucket(ns)].fetch_add(1, std::memory_order_relaxed);
+                lowerTo(shared->min, ns);
+                raiseTo(shared->max, ns);
+            }
+
+            void fail(const CallSite &site)
+            {
+                SharedSite *shared = this->site(site);
+                if (shared == nullptr)
+                    return;
+                shared->calls.fetch_add(1, std::memory_order_relaxed);
+                shared->failures.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+    }
+
+    // Per call site statistics of this process in POSIX shared memory, read live by slogtop
+    class SharedStats
+    {
+    private:
+        std::mutex _mutex;
+        std::atomic<detail::SharedMap *> _map;
+        // Closed maps stay mapped, a writer that loaded one may still be using it
+        std::vector<std::unique_ptr<detail::SharedMap>> _maps;
+        std::string _name;
+
+    public:
+        SharedStats()
+            : _map(nullptr)
+        {
+        }
+        ~SharedStats()
+        {
+            close();
+        }
+        SharedStats(const SharedStats &) = delete;
+        SharedStats &operator=(const SharedStats &) = delete;
+
+        detail::SharedMap *map() const
+        {
+            return _map.load(std::memory_order_acquire);
+        }
+
+        bool open(uint32_t sites)
+        {
+#ifdef _WIN32
+            (void)sites;
+            return false;
+#else
+            close();
+            std::lock_guard<std::mutex> lock(_mutex);
+            char name[64];
+            std::snprintf(name, sizeof(name), "%s%d", SLOG_SHARED_PREFIX, static_cast<int>(::getpid()));
+            size_t size = sizeof(detail::SharedHeader) + sites * sizeof(detail::SharedSite);
+            ::shm_unlink(name);
+            int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+            if (fd < 0)
+                return false;
+            if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+            {
+                ::close(fd);
+                ::shm_unlink(name);
+                return false;
+            }
+            void *base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED)
+            {
+                ::shm_unlink(name);
+                return false;
+            }
+            std::unique_ptr<detail::SharedMap> map(new detail::SharedMap);
+            map->base = base;
+            map->size = size;
+            map->header = static_cast<detail::SharedHeader *>(base);
+            map->sites = reinterpret_cast<detail::SharedSite *>(map->header + 1);
+            for (uint32_t i = 0; i < sites; ++i)
+                map->sites[i].min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+            map->header->order = SLOG_SHARED_ORDER;
+            map->header->version = SLOG_SHARED_VERSION;
+            map->header->sites = sites;
+            map->header->buckets = detail::kHistogramBuckets;
+            map->header->pid = static_cast<int32_t>(::getpid());
+            map->header->started = wallTime();
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(map->header->magic, SLOG_SHARED_MAGIC, 8); // Readers skip the table until it is set
+            _name = name;
+            _map.store(map.get(), std::memory_order_release);
+            _maps.push_back(std::move(map));
+            return true;
+#endif
+        }
+
+        // Stop publishing and remove the name, readers attached keep their view
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _map.store(nullptr, std::memory_order_release);
+#ifndef _WIN32
+            if (!_name.empty())
+                ::shm_unlink(_name.c_str());
+#endif
+            _name.clear();
+        }
+    };
+
+    inline SharedStats &sharedStats()
+    {
+        static SharedStats stats;
+        return stats;
+    }
+
+    // Publish the statistics of decorated calls and SENTRY scopes in shared memory named SLOG_SHARED_PREFIX
+    // and the process id, for up to sites call sites; independent of the level, the sinks and aggregation
+    inline bool openSharedStats(uint32_t sites = 1024)
+    {
+        return sharedStats().open(sites);
+    }
+
+    inline void closeSharedStats()
+    {
+        sharedStats().close();
+    }
+}
+
+#ifndef SLOG_TRACE_BUFFER_EVENTS
+#define SLOG_TRACE_BUFFER_EVENTS 4096 // Events a thread collects before writing them as one block
+#endif
+
+namespace slog
+{
+    namespace detail
+    {
+        struct TraceEvent
+        {
+            const CallSite *site;
+            int64_t start;    // ns since the trace was opened
+            int64_t duration; // ns
+            bool failed;
+        };
+
+        // Events of one thread, the lock is only contended while the trace is flushed
+        struct ThreadTrace
+        {
+            std::mutex mutex;
+            std::vector<TraceEvent> events;
+            uint32_t tid;
+        };
+
+        inline void appendText(std::vector<char> &out, const char *text)
+        {
+            out.insert(out.end(), text, text + std::strlen(text));
+        }
+
+        // Nanoseconds as microseconds with three decimals
+        inline void appendMicros(std::vector<char> &out, int64_t ns)
+        {
+            if (ns < 0)
+            {
+                out.push_back('-');
+                ns = -ns;
+            }
+            char digits[24];
+            int count = 0;
+            uint64_t value = static_cast<uint64_t>(ns);
+            do
+            {
+                digits[count++] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            } while (value != 0 || count < 4);
+            while (count > 3)
+                out.push_back(digits[--count]);
+            out.push_back('.');
+            while (count > 0)
+                out.push_back(digits[--count]);
+        }
+
+        inline void appendJsonString(std::vector<char> &out, const char *text)
+        {
+            out.push_back('"');
+            for (const char *c = text != nullptr ? text : ""; *c != '\0'; ++c)
+            {
+                unsigned char ch = static_cast<unsigned char>(*c);
+                if (ch == '"' || ch == '\\')
+                {
+                    out.push_back('\\');
+                    out.push_back(*c);
+                }
+                else if (ch < 0x20)
+                {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                    appendText(out, escaped);
+                }
+                else
+                    out.push_back(*c);
+            }
+            out.push_back('"');
+        }
+
+        inline int processId()
+        {
+#ifdef _WIN32
+            return _getpid();
+#else
+            return static_cast<int>(::getpid());
+#endif
+        }
+    }
+
+    // Chrome trace event file of decorated calls and SENTRY scopes, loads in chrome://tracing and Perfetto
+    // Written in the JSON array format, which both accept without the closing bracket after a crash
+    class TraceLog
+    {
+    private:
+        std::mutex _mutex; // File and thread list
+        FILE *_file;
+        std::atomic<bool> _enabled;
+        std::atomic<int64_t> _origin;
+        std::vector<std::shared_ptr<detail::ThreadTrace>> _threads;
+        uint32_t _next_tid;
+        bool _first;
+        std::vector<char> _text;
+        int _pid;
+
+        // Constant parts of the events of a site, escaped once
+        struct SiteText
+        {
+            std::string head; // Up to the start time
+            std::string tail; // From the arguments on, without the closing braces
+        };
+
+        std::unordered_map<const CallSite *, SiteText> _sites;
+
+        const SiteText &siteText(const CallSite &site)
+        {
+            std::unordered_map<const CallSite *, SiteText>::iterator found = _sites.find(&site);
+            if (found != _sites.end())
+                return found->second;
+            std::vector<char> text;
+            detail::appendText(text, "{\"name\":");
+            detail::appendJsonString(text, site.func_name);
+            detail::appendText(text, ",\"cat\":\"slog\",\"ph\":\"X\",\"ts\":");
+            SiteText &cached = _sites[&site];
+            cached.head.assign(text.begin(), text.end());
+            text.clear();
+            detail::appendText(text, ",\"args\":{\"file\":");
+            detail::appendJsonString(text, site.file_name);
+            detail::appendText(text, ",\"line\":");
+            detail::appendText(text, std::to_string(site.line_no).c_str());
+            if (site.args_name != nullptr)
+            {
+                detail::appendText(text, ",\"args\":");
+                detail::appendJsonString(text, site.args_name);
+            }
+            cached.tail.assign(text.begin(), text.end());
+            return cached;
+        }
+
+        // Format a block of events of one thread, called with _mutex held
+        void write(const std::vector<detail::TraceEvent> &events, uint32_t tid)
+        {
+            if (_file == nullptr || events.empty())
+                return;
+            _text.clear();
+            std::string ids = ",\"pid\":" + std::to_string(_pid) + ",\"tid\":" + std::to_string(tid);
+            for (const detail::TraceEvent &event : events)
+            {
+                const SiteText &site = siteText(*event.site);
+                detail::appendText(_text, _first ? "\n" : ",\n");
+                _first = false;
+                _text.insert(_text.end(), site.head.begin(), site.head.end());
+                detail::appendMicros(_text, event.start);
+                detail::appendText(_text, ",\"dur\":");
+                detail::appendMicros(_text, event.duration);
+                _text.insert(_text.end(), ids.begin(), ids.end());
+                _text.insert(_text.end(), site.tail.begin(), site.tail.end());
+                detail::appendText(_text, event.failed ? ",\"failed\":true}}" : "}}");
+            }
+            fwrite(_text.data(), 1, _text.size(), _file);
+        }
+
+        // Write out what every thread collected, called with _mutex held
+        void drain()
+        {
+            for (const std::shared_ptr<detail::ThreadTrace> &thread : _threads)
+            {
+                std::lock_guard<std::mutex> lock(thread->mutex);
+                write(thread->events, thread->tid);
+                thread->events.clear();
+            }
+        }
+
+    public:
+        TraceLog()
+            : _file(nullptr),
+              _enabled(false),
+              _origin(0),
+              _next_tid(1),
+              _first(true),
+              _pid(detail::processId())
+        {
+        }
+        ~TraceLog()
+        {
+            close();
+        }
+        TraceLog(const TraceLog &) = delete;
+        TraceLog &operator=(const TraceLog &) = delete;
+
+        // Trace clock in ns, the SLOG_CLOCK policy so a TscClock build reads the TSC only
+        static int64_t now()
+        {
+            return DefaultClock::toNs(DefaultClock::now());
+        }
+
+        bool open(const char *path)
+        {
+            close();
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (const std::shared_ptr<detail::ThreadTrace> &thread : _threads)
+            {
+                std::lock_guard<std::mutex> thread_lock(thread->mutex);
+                thread->events.clear();
+            }
+            _file = fopen(path, "wb");
+            if (_file == nullptr)
+                return false;
+            setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+            fputs("[", _file);
+            _first = true;
+            _origin.store(now(), std::memory_order_relaxed);
+            _enabled.store(true);
+            return true;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _enabled.store(false);
+            if (_file == nullptr)
+                return;
+            drain();
+            fputs("\n]\n", _file);
+            fclose(_file);
+            _file = nullptr;
+        }
+
+        // Write the events collected so far by every thread
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            drain();
+            if (_file != nullptr)
+                fflush(_file);
+        }
+
+        bool enabled() const
+        {
+            return _enabled.load(std::memory_order_relaxed);
+        }
+
+        std::shared_ptr<detail::ThreadTrace> attach()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::shared_ptr<detail::ThreadTrace> thread = std::make_shared<detail::ThreadTrace>();
+            thread->tid = _next_tid++;
+            thread->events.reserve(SLOG_TRACE_BUFFER_EVENTS);
+            _threads.push_back(thread);
+            return thread;
+        }
+
+        // A thread ends, what it collected is written
+        void detach(const std::shared_ptr<detail::ThreadTrace> &thread)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            {
+                std::lock_guard<std::mutex> thread_lock(thread->mutex);
+                write(thread->events, thread->tid);
+                thread->events.clear();
+            }
+            _threads.erase(std::remove(_threads.begin(), _threads.end(), thread), _threads.end());
+        }
+
+        // One complete event, start from now()
+        void add(const CallSite &site, int64_t start, int64_t duration, bool failed);
+    };
+
+    inline TraceLog &traceLog()
+    {
+        static TraceLog log;
+        return log;
+    }
+
+    namespace detail
+    {
+        // Buffer of the calling thread, written when the thread ends
+        struct ThreadTraceHolder
+        {
+            std::shared_ptr<ThreadTrace> trace;
+            ~ThreadTraceHolder()
+            {
+                if (trace)
+                    traceLog().detach(trace);
+            }
+        };
+    }
+
+    inline void TraceLog::add(const CallSite &site, int64_t start, int64_t duration, bool failed)
+    {
+        thread_local detail::ThreadTraceHolder holder;
+        if (!holder.trace)
+            holder.trace = attach();
+        detail::ThreadTrace &thread = *holder.trace;
+        std::unique_lock<std::mutex> lock(thread.mutex);
+        thread.events.push_back(detail::TraceEvent{&site, start - _origin.load(std::memory_order_relaxed), duration, failed});
+        if (thread.events.size() < SLOG_TRACE_BUFFER_EVENTS)
+            return;
+        std::vector<detail::TraceEvent> block;
+        block.reserve(SLOG_TRACE_BUFFER_EVENTS);
+        block.swap(thread.events);
+        lock.unlock();
+        std::lock_guard<std::mutex> file_lock(_mutex);
+        write(block, thread.tid);
+    }
+
+    // Write every decorated call and SENTRY scope as a trace event, next to the text output
+    inline bool openTrace(const char *path)
+    {
+        return traceLog().open(path);
+    }
+
+    // Write what is left and close the trace file
+    inline void closeTrace()
+    {
+        traceLog().close();
+    }
+
+    inline void flushTrace()
+    {
+        traceLog().flush();
+    }
+}
+
+namespace slog
+{
+    // Merged call tree, times in ns
+    struct ProfileNode
+    {
+        const CallSite *site; // nullptr for the root
+        uint64_t count;
+        int64_t total; // Inclusive time
+        int64_t self;  // Total minus the time of decorated calls and scopes inside
+        std::vector<ProfileNode> children;
+    };
+
+    namespace detail
+    {
+        // Call tree of one thread, its thread changes the shape under the lock and only reads it without
+        class ThreadProfile
+        {
+        private:
+            struct Node
+            {
+                const CallSite *site;
+                uint64_t count;
+                int64_t total;
+                int64_t self;
+                std::vector<uint32_t> children;
+            };
+
+            struct Frame
+            {
+                uint32_t node;
+                int64_t inner; // Time of the finished children
+            };
+
+            std::mutex _mutex;
+            std::vector<Node> _nodes;
+            std::vector<Frame> _stack;
+
+            void merge(uint32_t index, ProfileNode &into) const
+            {
+                const Node &node = _nodes[index];
+                into.count += node.count;
+                into.total += node.total;
+                into.self += node.self;
+                for (uint32_t child : node.children)
+                {
+                    const CallSite *site = _nodes[child].site;
+                    std::vector<ProfileNode>::iterator found =
+                        std::find_if(into.children.begin(), into.children.end(),
+                                     [site](const ProfileNode &item) { return item.site == site; });
+                    if (found == into.children.end())
+                    {
+                        into.children.push_back(ProfileNode{site, 0, 0, 0, {}});
+                        found = into.children.end() - 1;
+                    }
+                    merge(child, *found);
+                }
+            }
+
+        public:
+            ThreadProfile()
+                : _nodes(1, Node{nullptr, 0, 0, 0, {}}),
+                  _stack(1, Frame{0, 0})
+            {
+            }
+
+            void enter(const CallSite &site)
+            {
+                uint32_t parent = _stack.back().node;
+                for (uint32_t child : _nodes[parent].children)
+                {
+                    if (_nodes[child].site == &site)
+                    {
+                        _stack.push_back(Frame{child, 0});
+                        return;
+                    }
+                }
+                std::lock_guard<std::mutex> lock(_mutex);
+                uint32_t child = static_cast<uint32_t>(_nodes.size());
+                _nodes.push_back(Node{&site, 0, 0, 0, {}});
+                _nodes[parent].children.push_back(child);
+                _stack.push_back(Frame{child, 0});
+            }
+
+            void leave(int64_t duration)
+            {
+                Frame frame = _stack.back();
+                _stack.pop_back();
+                _stack.back().inner += duration;
+                std::lock_guard<std::mutex> lock(_mutex);
+                Node &node = _nodes[frame.node];
+                ++node.count;
+                node.total += duration;
+                node.self += duration - frame.inner;
+            }
+
+            void mergeInto(ProfileNode &root)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                merge(0, root);
+            }
+
+            void reset()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (Node &node : _nodes)
+                {
+                    node.count = 0;
+                    node.total = 0;
+                    node.self = 0;
+                }
+            }
+        };
+
+        // Trees of all threads, kept after their thread ends
+        class ProfileRegistry
+        {
+        private:
+            std::mutex _mutex;
+            std::vector<std::shared_ptr<ThreadProfile>> _threads;
+
+        public:
+            std::shared_ptr<ThreadProfile> create()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _threads.push_back(std::make_shared<ThreadProfile>());
+                return _threads.back();
+            }
+
+            ProfileNode collect()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                ProfileNode root = {nullptr, 0, 0, 0, {}};
+                for (const std::shared_ptr<ThreadProfile> &thread : _threads)
+                    thread->mergeInto(root);
+                return root;
+            }
+
+            void reset()
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (const std::shared_ptr<ThreadProfile> &thread : _threads)
+                    thread->reset();
+            }
+        };
+
+        inline ProfileRegistry &profileRegistry()
+        {
+            static ProfileRegistry registry;
+            return registry;
+        }
+
+        inline ThreadProfile &threadProfile()
+        {
+            thread_local std::shared_ptr<ThreadProfile> profile = profileRegistry().create();
+            return *profile;
+        }
+
+        inline std::atomic<bool> &profileMode()
+        {
+            static std::atomic<bool> enabled(false);
+            return enabled;
+        }
+    }
+
+    // Build a call tree per thread out of the decorated calls and scopes, with total and self time
+    inline void setProfile(bool enable)
+    {
+        detail::profileMode().store(enable, std::memory_order_relaxed);
+    }
+
+    inline bool profiling()
+    {
+        return detail::profileMode().load(std::memory_order_relaxed);
+    }
+
+    // Merge the trees of all threads by call path, on demand
+    inline ProfileNode collectProfile()
+    {
+        return detail::profileRegistry().collect();
+    }
+
+    inline void resetProfile()
+    {
+        detail::profileRegistry().reset();
+    }
+
+    namespace detail
+    {
+        inline void dumpProfileNode(const ProfileNode &node, int depth)
+        {
+            for (const ProfileNode &child : node.children)
+            {
+                SLOG_WRITE(CE_Debug, CPLE_None, "  %12llu %12.3f %12.3f  %*s%s (%s:%d)",
+                           static_cast<unsigned long long>(child.count), child.total / 1e6, child.self / 1e6,
+                           depth * 2, "", child.site->func_name, child.site->file_name, child.site->line_no);
+                dumpProfileNode(child, depth + 1);
+            }
+        }
+    }
+
+    // Write the merged call tree through SINFO, times in ms
+    inline void dumpProfile()
+    {
+        char time_str[SLOG_TIME_BUFFER_SIZE];
+        formatTime(time_str, sizeof(time_str));
+        ProfileNode root = collectProfile();
+        SLOG_WRITE(CE_Debug, CPLE_None, "= %s", time_str);
+        SLOG_WRITE(CE_Debug, CPLE_None, "  %12s %12s %12s  %s", "calls", "total(ms)", "self(ms)", "function");
+        detail::dumpProfileNode(root, 0);
+    }
+}
+
+#ifndef SLOG_CAPTURE_SIZE
+#define SLOG_CAPTURE_SIZE 256 // Bytes of argument and result values kept for one call
+#endif
+
+#ifndef SLOG_CAPTURE_FIELDS
+#define SLOG_CAPTURE_FIELDS 16 // Arguments and result kept for one call
+#endif
+
+#ifndef SLOG_CAPTURE_STRING
+#define SLOG_CAPTURE_STRING 48 // Characters kept of a string
+#endif
+
+#ifndef SLOG_CAPTURE_ITEMS
+#define SLOG_CAPTURE_ITEMS 4 // Elements kept of a container
+#endif
+
+namespace slog
+{
+    // Layout of captured argument and result values
+    enum class CaptureStyle : uint8_t
+    {
+        None,   // Values are not captured
+        Logfmt, // arg0=1 arg1="text" ret=[1,2]
+        Json    // {"arg0":1,"arg1":"text","ret":[1,2]}
+    };
+
+    namespace detail
+    {
+        inline std::atomic<CaptureStyle> &captureMode()
+        {
+            static std::atomic<CaptureStyle> style(CaptureStyle::None);
+            return style;
+        }
+
+        template <typename...>
+        struct MakeVoid
+        {
+            typedef void type;
+        };
+
+        template <typename... T>
+        using VoidT = typename MakeVoid<T...>::type;
+    }
+
+    // Keep the argument values and the result of decorated calls, written as one more line of their record
+    inline void setCapture(CaptureStyle style)
+    {
+        detail::captureMode().store(style, std::memory_order_relaxed);
+    }
+
+    inline CaptureStyle captureStyle()
+    {
+        return detail::captureMode().load(std::memory_order_relaxed);
+    }
+
+    // Bounded copy of a value taken before the call, stops at the end of the buffer
+    class CaptureWriter
+    {
+    private:
+        unsigned char *_data;
+        size_t _size;
+        size_t _used;
+        bool _ok;
+
+    public:
+        CaptureWriter(unsigned char *data, size_t size, size_t used)
+            : _data(data),
+              _size(size),
+              _used(used),
+              _ok(true)
+        {
+        }
+
+        template <typename T>
+        void put(const T &value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be put");
+            if (!_ok || _used + sizeof(T) > _size)
+            {
+                _ok = false;
+                return;
+            }
+            std::memcpy(_data + _used, &value, sizeof(T));
+            _used += sizeof(T);
+        }
+
+        // Length and at most SLOG_CAPTURE_STRING characters, nullptr is kept as such
+        void putString(const char *text, size_t size)
+        {
+            put<uint32_t>(text != nullptr ? static_cast<uint32_t>(size) : UINT32_MAX);
+            size_t kept = text != nullptr ? std::min<size_t>(size, SLOG_CAPTURE_STRING) : 0;
+            if (!_ok || _used + kept > _size)
+            {
+                _ok = false;
+                return;
+            }
+            std::memcpy(_data + _used, text, kept);
+            _used += kept;
+        }
+
+        size_t used() const
+        {
+            return _used;
+        }
+
+        bool ok() const
+        {
+            return _ok;
+        }
+    };
+
+    // Reads back what CaptureWriter put, in the same order
+    class CaptureReader
+    {
+    private:
+        const unsigned char *_data;
+
+    public:
+        explicit CaptureReader(const unsigned char *data)
+            : _data(data)
+        {
+        }
+
+        template <typename T>
+        T get()
+        {
+            T value;
+            std::memcpy(&value, _data, sizeof(T));
+            _data += sizeof(T);
+            return value;
+        }
+
+        // nullptr for a null string, size is the full length and kept what follows
+        const char *getString(size_t &size, size_t &kept)
+        {
+            uint32_t length = get<uint32_t>();
+            if (length == UINT32_MAX)
+            {
+                size = kept = 0;
+                return nullptr;
+            }
+            size = length;
+            kept = std::min<size_t>(length, SLOG_CAPTURE_STRING);
+            const char *text = reinterpret_cast<const char *>(_data);
+            _data += kept;
+            return text;
+        }
+    };
+
+    // Text of captured values, only built for records that are written
+    class ValueWriter
+    {
+    private:
+        std::string &_out;
+        CaptureStyle _style;
+        size_t _fields;
+
+        template <typename FMT, typename T>
+        void print(FMT format, T value)
+        {
+            char text[32];
+            int len = detail::formatTo(text, sizeof(text), format, value);
+            _out.append(text, static_cast<size_t>(std::max(0, std::min<int>(len, sizeof(text) - 1))));
+        }
+
+    public:
+        ValueWriter(std::string &out, CaptureStyle style)
+            : _out(out),
+              _style(style),
+              _fields(0)
+        {
+        }
+
+        CaptureStyle style() const
+        {
+            return _style;
+        }
+
+        void begin()
+        {
+            if (_style == CaptureStyle::Json)
+                _out += '{';
+        }
+
+        void key(const char *name, size_t index = SIZE_MAX)
+        {
+            if (_fields++ > 0)
+                _out += _style == CaptureStyle::Json ? ',' : ' ';
+            if (_style == CaptureStyle::Json)
+                _out += '"';
+            _out += name;
+            if (index != SIZE_MAX)
+                print(SLOG_FORMAT("%zu"), index);
+            _out += _style == CaptureStyle::Json ? "\":" : "=";
+        }
+
+        void end()
+        {
+            if (_style == CaptureStyle::Json)
+                _out += '}';
+        }
+
+        void raw(const char *text)
+        {
+            _out += text;
+        }
+
+        void null()
+        {
+            _out += "null";
+        }
+
+        // A value that was not captured
+        void unknown()
+        {
+            _out += _style == CaptureStyle::Json ? "\"?\"" : "?";
+        }
+
+        void boolean(bool value)
+        {
+            _out += value ? "true" : "false";
+        }
+
+        void number(int64_t value)
+        {
+            print(SLOG_FORMAT("%lld"), static_cast<long long>(value));
+        }
+
+        void number(uint64_t value)
+        {
+            print(SLOG_FORMAT("%llu"), static_cast<unsigned long long>(value));
+        }
+
+        void number(double value)
+        {
+            if (_style == CaptureStyle::Json && !std::isfinite(value))
+                null();
+            else
+                print(SLOG_FORMAT("%g"), value);
+        }
+
+        // Quoted and escaped, "..." marks a string that was cut
+        void string(const char *text, size_t kept, size_t size)
+        {
+            if (text == nullptr)
+            {
+                null();
+                return;
+            }
+            _out += '"';
+            for (size_t i = 0; i < kept; ++i)
+            {
+                unsigned char ch = static_cast<unsigned char>(text[i]);
+                if (ch == '"' || ch == '\\')
+                {
+                    _out += '\\';
+                    _out += static_cast<char>(ch);
+                }
+                else if (ch == '\n')
+                    _out += "\\n";
+                else if (ch == '\t')
+                    _out += "\\t";
+                else if (ch < 0x20)
+                    print(SLOG_FORMAT("\\u%04x"), static_cast<unsigned>(ch));
+                else
+                    _out += static_cast<char>(ch);
+            }
+            if (kept < size)
+                _out += "...";
+            _out += '"';
+        }
+
+        // A container of size elements of which shown follow, logfmt [1,2,...](5) and JSON {"size":5,"head":[1,2]}
+        void beginList(size_t shown, size_t size)
+        {
+            if (_style == CaptureStyle::Json && shown < size)
+            {
+                _out += "{\"size\":";
+                number(static_cast<uint64_t>(size));
+                _out += ",\"head\":";
+            }
+            _out += '[';
+        }
+
+        void item(size_t index)
+        {
+            if (index > 0)
+                _out += ',';
+        }
+
+        void endList(size_t shown, size_t size)
+        {
+            if (shown < size && _style != CaptureStyle::Json)
+            {
+                _out += shown > 0 ? ",...](" : "...](";
+                number(static_cast<uint64_t>(size));
+                _out += ')';
+                return;
+            }
+            _out += ']';
+            if (shown < size)
+                _out += '}';
+        }
+    };
+
+    // How values of T are captured before a call and rendered when its record is written
+    // Specialize it for types of your own, the primary template keeps nothing
+    template <typename T, typename ENABLE = void>
+    struct Formatter
+    {
+        static void capture(CaptureWriter & /* out */, const T & /* value */) {}
+        static void render(ValueWriter &out, CaptureReader & /* in */)
+        {
+            out.unknown();
+        }
+    };
+
+    template <typename T>
+    struct Formatter<T, std::enable_if_t<std::is_integral<T>::value>>
+    {
+        static void capture(CaptureWriter &out, const T &value)
+        {
+            out.put(value);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            T value = in.get<T>();
+            if (std::is_same<T, bool>::value)
+                out.boolean(value != 0);
+            else if (std::is_same<T, char>::value)
+            {
+                char ch = static_cast<char>(value);
+                out.string(&ch, 1, 1);
+            }
+            else if (std::is_signed<T>::value)
+                out.number(static_cast<int64_t>(value));
+            else
+                out.number(static_cast<uint64_t>(value));
+        }
+    };
+
+    template <typename T>
+    struct Formatter<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    {
+        static void capture(CaptureWriter &out, const T &value)
+        {
+            out.put(value);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            out.number(static_cast<double>(in.get<T>()));
+        }
+    };
+
+    template <typename T>
+    struct Formatter<T, std::enable_if_t<std::is_enum<T>::value>>
+    {
+        static void capture(CaptureWriter &out, const T &value)
+        {
+            out.put(value);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            out.number(static_cast<int64_t>(in.get<T>()));
+        }
+    };
+
+    template <typename T>
+    struct Formatter<T, std::enable_if_t<std::is_pointer<T>::value &&
+                                         !std::is_function<std::remove_pointer_t<T>>::value>>
+    {
+        static void capture(CaptureWriter &out, const T &value)
+        {
+            out.put(value);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            const void *value = in.get<T>();
+            if (value == nullptr)
+                out.null();
+            else
+            {
+                char text[24];
+                int len = detail::formatTo(text, sizeof(text), SLOG_FORMAT("\"%p\""), value);
+                if (len > 0 && static_cast<size_t>(len) < sizeof(text))
+                    out.raw(text);
+            }
+        }
+    };
+
+    template <>
+    struct Formatter<const char *>
+    {
+        static void capture(CaptureWriter &out, const char *value)
+        {
+            out.putString(value, value != nullptr ? std::strlen(value) : 0);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            size_t size;
+            size_t kept;
+            const char *text = in.getString(size, kept);
+            out.string(text, kept, size);
+        }
+    };
+
+    template <>
+    struct Formatter<char *> : Formatter<const char *>
+    {
+    };
+
+    template <>
+    struct Formatter<std::nullptr_t>
+    {
+        static void capture(CaptureWriter & /* out */, std::nullptr_t) {}
+        static void render(ValueWriter &out, CaptureReader & /* in */)
+        {
+            out.null();
+        }
+    };
+
+    template <>
+    struct Formatter<std::string> : Formatter<const char *>
+    {
+        static void capture(CaptureWriter &out, const std::string &value)
+        {
+            out.putString(value.data(), value.size());
+        }
+    };
+
+    template <typename A, typename B>
+    struct Formatter<std::pair<A, B>>
+    {
+        static void capture(CaptureWriter &out, const std::pair<A, B> &value)
+        {
+            Formatter<std::decay_t<A>>::capture(out, value.first);
+            Formatter<std::decay_t<B>>::capture(out, value.second);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            out.beginList(2, 2);
+            Formatter<std::decay_t<A>>::render(out, in);
+            out.item(1);
+            Formatter<std::decay_t<B>>::render(out, in);
+            out.endList(2, 2);
+        }
+    };
+
+    // Anything with begin, end and size, as its size and the first SLOG_CAPTURE_ITEMS elements
+    template <typename T>
+    struct Formatter<T, detail::VoidT<decltype(std::declval<const T &>().begin()),
+                                      decltype(std::declval<const T &>().end()),
+                                      decltype(std::declval<const T &>().size())>>
+    {
+        typedef std::decay_t<decltype(*std::declval<const T &>().begin())> Item;
+
+        static void capture(CaptureWriter &out, const T &value)
+        {
+            uint32_t size = static_cast<uint32_t>(value.size());
+            uint32_t shown = std::min<uint32_t>(size, SLOG_CAPTURE_ITEMS);
+            out.put(size);
+            out.put(shown);
+            uint32_t i = 0;
+            for (auto it = value.begin(); i < shown; ++it, ++i)
+                Formatter<Item>::capture(out, *it);
+        }
+        static void render(ValueWriter &out, CaptureReader &in)
+        {
+            uint32_t size = in.get<uint32_t>();
+            uint32_t shown = in.get<uint32_t>();
+            out.beginList(shown, size);
+            for (uint32_t i = 0; i < shown; ++i)
+            {
+                out.item(i);
+                Formatter<Item>::render(out, in);
+            }
+            out.endList(shown, size);
+        }
+    };
+
+    namespace detail
+    {
+        // Argument and result values of one decorated call, taken before and after it
+        class CaptureBuffer
+        {
+        private:
+            typedef void (*RenderFn)(ValueWriter &out, CaptureReader &in);
+
+            struct Field
+            {
+                RenderFn render; // nullptr when the value did not fit
+                uint16_t offset;
+                bool result;
+            };
+
+            unsigned char _data[SLOG_CAPTURE_SIZE];
+            Field _fields[SLOG_CAPTURE_FIELDS];
+            size_t _used;
+            size_t _count;
+
+        public:
+            CaptureBuffer()
+                : _used(0),
+                  _count(0)
+            {
+            }
+            CaptureBuffer(const CaptureBuffer &) = delete;
+            CaptureBuffer &operator=(const CaptureBuffer &) = delete;
+
+            template <typename T>
+            void add(const T &value, bool result)
+            {
+                typedef std::decay_t<T> Type;
+                if (_count == SLOG_CAPTURE_FIELDS)
+                    return;
+                CaptureWriter writer(_data, sizeof(_data), _used);
+                Formatter<Type>::capture(writer, value);
+                _fields[_count++] = Field{writer.ok() ? &Formatter<Type>::render : nullptr,
+                                          static_cast<uint16_t>(_used), result};
+                if (writer.ok())
+                    _used = writer.used();
+            }
+
+            template <typename... ARGS>
+            void arguments(const ARGS &...args)
+            {
+                int expand[] = {0, (add(args, false), 0)...};
+                (void)expand;
+            }
+
+            void render(std::string &out, CaptureStyle style) const
+            {
+                ValueWriter writer(out, style);
+                writer.begin();
+                size_t index = 0;
+                for (size_t i = 0; i < _count; ++i)
+                {
+                    const Field &field = _fields[i];
+                    if (field.result)
+                        writer.key("ret");
+                    else
+                        writer.key("arg", index++);
+                    CaptureReader reader(_data + field.offset);
+                    if (field.render != nullptr)
+                        field.render(writer, reader);
+                    else
+                        writer.unknown();
+                }
+                writer.end();
+            }
+        };
+
+        inline std::string &captureText()
+        {
+            thread_local std::string text;
+            return text;
+        }
+    }
+}
+
+namespace slog
+{
+    // A decorated call threw, header is the entry record written with it unless it is out already
+    // header_time is when the call started, 0 for now, values the captured arguments if any
+    inline void reportFailure(const CallSite &site, EventKind header, bool written, EventKind kind,
+                              const char *message = nullptr, int64_t header_time = 0, const char *values = nullptr)
+    {
+        if (aggregating())
+            siteShard(site).fail();
+        detail::FlightMap *flight = flightRecorder().map();
+        if (flight == nullptr && !shouldLog(eventLevel(kind), site))
+            return;
+        int64_t now = wallTime();
+        if (flight != nullptr)
+        {
+            detail::flightEvent(*flight, kind, site, now, 0, message);
+            if (!shouldLog(eventLevel(kind), site))
+                return;
+        }
+        Event events[2];
+        size_t count = 0;
+        if (!written)
+            events[count++] = Event{header, &site, header_time != 0 ? header_time : now, 0, values, nullptr};
+        events[count++] = Event{kind, &site, now, 0, message, nullptr};
+        emit(events, count);
+    }
+
+    // What is written for one call, decided when it starts
+    // A call is written as one record when it ends, SENTRY writes its entry at once
+    // With slower_than sampling the entry waits for the duration in both cases
+    class CallTrace
+    {
+    private:
+        const CallSite &_site;
+        const Sampling *_sampling;
+        EventKind _header;
+        int64_t _time;     // Wall clock when the call started, kept for the entry record
+        int64_t _start;    // DefaultClock ticks when the call started, 0 unless tracing or profiling
+        int64_t _duration; // ns, -1 until the call ended
+        int64_t _queued;   // ns a task waited for a worker, written with the entry record
+        detail::FlightMap *_flight; // Flight recorder open when the call started
+        detail::SharedMap *_shared; // Shared statistics open when the call started
+        bool _trace;
+        bool _profile; // A frame of the thread's call tree is open
+        bool _aggregate;
+        bool _traced;
+        bool _deferred;
+        bool _written;                  // The entry record is out
+        detail::CaptureBuffer *_values; // Argument values taken for the record, nullptr when not captured
+        detail::CounterSample _counters; // Performance counters over the call, config is nullptr when not counted
+        detail::AllocationSample _allocations;
+
+        // Captured values as text, only built for a record that is written
+        const char *renderValues() const
+        {
+            if (_values == nullptr)
+                return nullptr;
+            std::string &text = detail::captureText();
+            text.clear();
+            _values->render(text, captureStyle());
+            return text.c_str();
+        }
+
+    public:
+        CallTrace(const CallSite &site, EventKind header)
+            : _site(site),
+              _sampling(nullptr),
+              _header(header),
+              _time(0),
+              _start(0),
+              _duration(-1),
+              _queued(0),
+              _flight(flightRecorder().map()),
+              _shared(sharedStats().map()),
+              _trace(traceLog().enabled()),
+              _profile(profiling()),
+              _aggregate(aggregating()),
+              _traced(false),
+              _deferred(false),
+              _written(false),
+              _values(nullptr)
+        {
+            _counters.config = nullptr;
+            _allocations.active = false;
+            if (_trace || _profile || _flight != nullptr || _shared != nullptr)
+                _start = DefaultClock::now();
+            if (_profile)
+                detail::threadProfile().enter(site);
+            if (_flight != nullptr)
+            {
+                _time = wallTime();
+                detail::flightEvent(*_flight, header, site, _time, 0);
+            }
+            if (!_aggregate && shouldLog(CE_Debug, site))
+            {
+                _sampling = siteSampling(site);
+                if (_sampling == nullptr)
+                    _traced = true;
+                else if (sampleCount(site, *_sampling))
+                {
+                    if (_sampling->slower_than_ns > 0)
+                        _deferred = true;
+                    else
+                        _traced = sampleRate(site, *_sampling);
+                }
+                if (_traced && _sampling != nullptr)
+                    site.written.fetch_add(1, std::memory_order_relaxed);
+                if (_traced && header == EventKind::Action)
+                {
+                    logEvent(header, site);
+                    _written = true;
+                }
+                else if ((_traced || _deferred) && _time == 0)
+                    _time = wallTime();
+            }
+            // Read last so the counters cover as little of slog as possible
+            if (_aggregate || ((_traced || _deferred) && !_written))
+            {
+                if (trackingAllocations())
+                    detail::startAllocations(_allocations);
+                if (countingCalls())
+                    detail::threadCounters().start(_counters);
+            }
+        }
+        ~CallTrace()
+        {
+            if (!_profile)
+                return;
+            if (_duration < 0)
+                _duration = DefaultClock::toNs(DefaultClock::now() - _start);
+            detail::threadProfile().leave(_duration);
+        }
+        CallTrace(const CallTrace &) = delete;
+        CallTrace &operator=(const CallTrace &) = delete;
+
+        // The call has to be timed
+        bool timed() const
+        {
+            return _aggregate || _start != 0 || ((_traced || _deferred) && !_written);
+        }
+
+        // Argument values are kept for a call that may be written
+        bool capturing() const
+        {
+            return (_traced || _deferred) && !_written && captureStyle() != CaptureStyle::None;
+        }
+
+        // Values to render into the entry record, filled before the call and alive until it ends
+        void capture(detail::CaptureBuffer &values)
+        {
+            _values = &values;
+        }
+
+        template <typename T>
+        void captureResult(const T &result)
+        {
+            if (_values != nullptr)
+                _values->add(result, true);
+        }
+
+        // The call goes on in another thread, its frame of the call tree ends with the launch
+        void detach()
+        {
+            if (!_profile)
+                return;
+            _profile = false;
+            detail::threadProfile().leave(DefaultClock::toNs(DefaultClock::now() - _start));
+        }
+
+        void queued(int64_t ns)
+        {
+            _queued = ns;
+        }
+
+        // The call completes in another thread, whose counters can not be compared with these
+        void dropCounters()
+        {
+            _counters.config = nullptr;
+            if (_allocations.active)
+                detail::stopAllocations(_allocations);
+            _allocations.active = false;
+        }
+
+        // Start of the call in CLOCK ticks, reuses the reading taken for tracing or profiling
+        template <typename CLOCK>
+        int64_t startTicks() const
+        {
+            if (std::is_same<CLOCK, DefaultClock>::value && _start != 0)
+                return _start;
+            return CLOCK::now();
+        }
+
+        // The call returned, its duration in ticks goes to the trace, the statistics or the log
+        // A SENTRY entry written when the scope started has no exit record
+        void succeed(int64_t ticks, ToNsFn to_ns)
+        {
+            if (_counters.config != nullptr)
+                detail::threadCounters().stop(_counters);
+            if (_allocations.active)
+                detail::stopAllocations(_allocations);
+            _duration = to_ns(ticks);
+            if (_flight != nullptr)
+                detail::flightEvent(*_flight, EventKind::Success, _site, _time + _duration, _duration);
+            if (_trace)
+                traceLog().add(_site, DefaultClock::toNs(_start), _duration, false);
+            if (_shared != nullptr)
+                _shared->record(_site, static_cast<uint64_t>(_duration));
+            if (_aggregate)
+            {
+                detail::SiteShard &shard = siteShard(_site);
+                shard.record(static_cast<uint64_t>(_duration));
+                shard.record(_counters);
+                shard.record(_allocations);
+                return;
+            }
+            if (_written)
+                return;
+            if (_deferred)
+            {
+                if (_duration < _sampling->slower_than_ns || !sampleRate(_site, *_sampling))
+                    return;
+                _site.written.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (!_traced)
+                return;
+            Event events[2];
+            size_t count = 0;
+            if (!_written)
+                events[count++] = Event{_header, &_site, _time, _queued, renderValues(), nullptr};
+            events[count++] = Event{EventKind::Success, &_site, wallTime(), ticks, detail::renderMeasured(_counters, _allocations),
+                                    to_ns};
+            emit(events, count);
+        }
+
+        void fail(EventKind kind, const char *message = nullptr)
+        {
+            if (_allocations.active)
+                detail::stopAllocations(_allocations);
+            if (_start != 0)
+                _duration = DefaultClock::toNs(DefaultClock::now() - _start);
+            if (_trace)
+                traceLog().add(_site, DefaultClock::toNs(_start), _duration, true);
+            if (_shared != nullptr)
+                _shared->fail(_site);
+            reportFailure(_site, _header, _written, kind, message, _time, renderValues());
+        }
+    };
+
+    // Scope of SENTRY and SSCOPE, times the block when tracing, profiling, aggregating or sampling slow blocks
+    class EntryScope
+    {
+    private:
+        CallTrace _trace;
+        int64_t _start;
+        bool _timed;
+        bool _failed;
+
+    public:
+        explicit EntryScope(const CallSite &site, EventKind header = EventKind::Action)
+            : _trace(site, header),
+              _start(0),
+              _timed(_trace.timed()),
+              _failed(false)
+        {
+            if (_timed)
+                _start = _trace.startTicks<DefaultClock>();
+        }
+        ~EntryScope()
+        {
+            if (_timed && !_failed)
+                _trace.succeed(DefaultClock::now() - _start, &DefaultClock::toNs);
+        }
+        EntryScope(const EntryScope &) = delete;
+        EntryScope &operator=(const EntryScope &) = delete;
+
+        void fail(EventKind kind, const char *message = nullptr)
+        {
+            _failed = true;
+            _trace.fail(kind, message);
+        }
+    };
+
+    namespace detail
+    {
+        // A call completing later, possibly in another thread, only the first completion is recorded
+        template <typename CLOCK>
+        class PendingCall
+        {
+        private:
+            CallTrace _trace;
+            CaptureBuffer _values;
+            int64_t _start;
+            const char *_lost; // Failure written when the call is dropped before it completes, nullptr until armed
+            std::atomic<bool> _done;
+
+        public:
+            explicit PendingCall(const CallSite &site)
+                : _trace(site, EventKind::Call),
+                  _start(0),
+                  _lost(nullptr),
+                  _done(false)
+            {
+            }
+            ~PendingCall()
+            {
+                if (_lost != nullptr && !_done.load(std::memory_order_acquire))
+                    _trace.fail(EventKind::Failure, _lost);
+            }
+            PendingCall(const PendingCall &) = delete;
+            PendingCall &operator=(const PendingCall &) = delete;
+
+            bool timed() const
+            {
+                return _trace.timed();
+            }
+
+            // Takes the arguments and starts the clock, lost is written if the completion never comes
+            template <typename... ARGS>
+            void arm(const char *lost, const ARGS &...args)
+            {
+                if (_trace.capturing())
+                {
+                    _values.arguments(args...);
+                    _trace.capture(_values);
+                }
+                _lost = lost;
+                _trace.dropCounters();
+                _start = _trace.template startTicks<CLOCK>();
+            }
+
+            void detach()
+            {
+                _trace.detach();
+            }
+
+            // Ends the frame of the launching thread in the call tree when the launch returns or throws
+            struct Launch
+            {
+                PendingCall &pending;
+                ~Launch()
+                {
+                    pending.detach();
+                }
+            };
+
+            // A worker picked the task up
+            void started()
+            {
+                _trace.queued(CLOCK::toNs(CLOCK::now() - _start));
+            }
+
+            void succeed()
+            {
+                int64_t ticks = CLOCK::now() - _start;
+                if (!_done.exchange(true, std::memory_order_acq_rel))
+                    _trace.succeed(ticks, &CLOCK::toNs);
+            }
+
+            template <typename T>
+            void succeed(const T &result)
+            {
+                int64_t ticks = CLOCK::now() - _start;
+                if (_done.exchange(true, std::memory_order_acq_rel))
+                    return;
+                _trace.captureResult(result);
+                _trace.succeed(ticks, &CLOCK::toNs);
+            }
+
+            void fail(EventKind kind, const char *message = nullptr)
+            {
+                if (!_done.exchange(true, std::memory_order_acq_rel))
+                    _trace.fail(kind, message);
+            }
+        };
+
+        // Runs call and completes pending with its result
+        template <typename CLOCK, typename CALL, typename RET = decltype(std::declval<CALL &>()()),
+                  std::enable_if_t<!std::is_same<RET, void>::value, int> = 1>
+        RET completeCall(PendingCall<CLOCK> &pending, CALL &&call)
+        {
+            RET result = call();
+            pending.succeed(result);
+            return std::forward<RET>(result);
+        }
+
+        template <typename CLOCK, typename CALL, typename RET = decltype(std::declval<CALL &>()()),
+                  std::enable_if_t<std::is_same<RET, void>::value, int> = 1>
+        RET completeCall(PendingCall<CLOCK> &pending, CALL &&call)
+        {
+            call();
+            pending.succeed();
+        }
+
+        // How a decorated function completes: when it returns, when its future is ready or when it calls back
+        struct ReturnCompletion
+        {
+        };
+        struct FutureCompletion
+        {
+        };
+        struct CallbackCompletion
+        {
+        };
+
+        template <typename T>
+        struct IsFuture : std::false_type
+        {
+        };
+        template <typename T>
+        struct IsFuture<std::future<T>> : std::true_type
+        {
+        };
+
+        template <typename T>
+        struct IsCallback : std::false_type
+        {
+        };
+        template <typename R, typename... A>
+        struct IsCallback<std::function<R(A...)>> : std::true_type
+        {
+        };
+
+        template <typename... ARGS>
+        struct LastArg
+        {
+            typedef void type;
+        };
+        template <typename T>
+        struct LastArg<T>
+        {
+            typedef std::decay_t<T> type;
+        };
+        template <typename T, typename... ARGS>
+        struct LastArg<T, ARGS...> : LastArg<ARGS...>
+        {
+        };
+
+        // A std::future result wins over a std::function last parameter
+        template <typename RET, typename... ARGS>
+        using CompletionOf = std::conditional_t<
+            IsFuture<RET>::value, FutureCompletion,
+            std::conditional_t<IsCallback<typename LastArg<ARGS...>::type>::value, CallbackCompletion, ReturnCompletion>>;
+
+        // The callback handed to the decorated function, records the call before it runs callback
+        template <typename CLOCK, typename R, typename... A>
+        std::function<R(A...)> completeOnCall(std::function<R(A...)> callback,
+                                              const std::shared_ptr<PendingCall<CLOCK>> &pending)
+        {
+            return [callback, pending](A... args) -> R
+            {
+                pending->succeed();
+                return callback(std::forward<A>(args)...);
+            };
+        }
+
+        template <typename T, typename CALL>
+        void settle(std::promise<T> &promise, CALL &&call)
+        {
+            promise.set_value(call());
+        }
+
+        template <typename CALL>
+        void settle(std::promise<void> &promise, CALL &&call)
+        {
+            call();
+            promise.set_value();
+        }
+
+        // A future of a timed call, settles the one handed to the caller once it is ready
+        class FutureWait
+        {
+        public:
+            virtual ~FutureWait()
+            {
+            }
+
+            // True once the future was ready and the call recorded, blocks at most timeout
+            virtual bool poll(std::chrono::microseconds timeout) = 0;
+        };
+
+        // Exceptions reach the caller through the future as they would without slog
+        template <typename T, typename CLOCK>
+        class PendingFuture : public FutureWait
+        {
+        private:
+            std::future<T> _future;
+            std::promise<T> _promise;
+            std::shared_ptr<PendingCall<CLOCK>> _pending;
+
+        public:
+            PendingFuture(std::future<T> future, std::promise<T> promise, std::shared_ptr<PendingCall<CLOCK>> pending)
+                : _future(std::move(future)),
+                  _promise(std::move(promise)),
+                  _pending(std::move(pending))
+            {
+            }
+
+            bool poll(std::chrono::microseconds timeout) override
+            {
+                if (_future.wait_for(timeout) != std::future_status::ready)
+                    return false;
+                try
+                {
+                    settle(_promise, [this]() -> T
+                           { return completeCall(*_pending, [this]() -> T { return _future.get(); }); });
+                }
+                catch (const std::exception &ex)
+                {
+                    _pending->fail(EventKind::Failure, ex.what());
+                    _promise.set_exception(std::current_exception());
+                }
+                catch (...)
+                {
+                    _pending->fail(EventKind::Fatal);
+                    _promise.set_exception(std::current_exception());
+                }
+                return true;
+            }
+        };
+
+        // One thread for the futures of all timed calls, started on first use
+        // Ready futures are settled at once, otherwise it blocks on the oldest for SLOG_FUTURE_POLL_US,
+        // so a call is seen to end by this thread up to that long after it did
+        // At exit the ready ones are settled, the others are left unrecorded
+        class FutureWaiter
+        {
+        private:
+            std::mutex _mutex;
+            std::condition_variable _wake;
+            std::vector<std::unique_ptr<FutureWait>> _incoming;
+            std::thread _thread;
+            bool _stop;
+
+            void run()
+            {
+                std::vector<std::unique_ptr<FutureWait>> waits;
+                for (;;)
+                {
+                    bool stop;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        if (waits.empty())
+                            _wake.wait(lock, [this]()
+                                       { return _stop || !_incoming.empty(); });
+                        for (std::unique_ptr<FutureWait> &wait : _incoming)
+                            waits.push_back(std::move(wait));
+                        _incoming.clear();
+                        stop = _stop;
+                    }
+                    size_t waiting = waits.size();
+                    waits.erase(std::remove_if(waits.begin(), waits.end(), [](const std::unique_ptr<FutureWait> &wait)
+                                               { return wait->poll(std::chrono::microseconds(0)); }),
+                                waits.end());
+                    if (stop)
+                    {
+                        // Never destroyed, the future of std::async would block until its task ends
+                        for (std::unique_ptr<FutureWait> &wait : waits)
+                            wait.release();
+                        return;
+                    }
+                    if (waits.size() == waiting && waits.front()->poll(std::chrono::microseconds(SLOG_FUTURE_POLL_US)))
+                        waits.erase(waits.begin());
+                }
+            }
+
+        public:
+            FutureWaiter()
+                : _stop(false)
+            {
+                sinks(); // Constructed first so they outlive the waiter at exit
+                asyncLogger();
+            }
+            ~FutureWaiter()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _wake.notify_one();
+                if (_thread.joinable())
+                    _thread.join();
+            }
+            FutureWaiter(const FutureWaiter &) = delete;
+            FutureWaiter &operator=(const FutureWaiter &) = delete;
+
+            void add(std::unique_ptr<FutureWait> wait)
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_thread.joinable())
+                    _thread = std::thread(&FutureWaiter::run, this);
+                _incoming.push_back(std::move(wait));
+                _wake.notify_one();
+            }
+        };
+
+        inline FutureWaiter &futureWaiter()
+        {
+            static FutureWaiter waiter;
+            return waiter;
+        }
+
+        // The future handed back completes when future does, after the waiter recorded the call
+        // A deferred future stays deferred, the call is recorded when get() or wait() runs it
+        template <typename T, typename CLOCK>
+        std::future<T> awaitFuture(std::future<T> future, std::shared_ptr<PendingCall<CLOCK>> pending)
+        {
+            if (future.wait_for(std::chrono::seconds(0)) == std::future_status::deferred)
+            {
+                return std::async(std::launch::deferred, [future = std::move(future), pending]() mutable -> T
+                                  {
+                    try
+                    {
+                        return completeCall(*pending, [&future]() -> T { return future.get(); });
+                    }
+                    catch (const std::exception &ex)
+                    {
+                        pending->fail(EventKind::Failure, ex.what());
+                        throw;
+                    }
+                    catch (...)
+                    {
+                        pending->fail(EventKind::Fatal);
+                        throw;
+                    } });
+            }
+            std::promise<T> promise;
+            std::future<T> result = promise.get_future();
+            futureWaiter().add(std::unique_ptr<FutureWait>(
+                new PendingFuture<T, CLOCK>(std::move(future), std::move(promise), std::move(pending))));
+            return result;
+        }
+
+        // func with copies of its arguments, called later
+        template <typename FUNC, typename... ARGS>
+        class BoundCall
+        {
+        private:
+            FUNC _func;
+            std::tuple<ARGS...> _args;
+
+            template <size_t... I>
+            decltype(auto) invoke(std::index_sequence<I...>)
+            {
+                return _func(std::get<I>(_args)...);
+            }
+
+        public:
+            BoundCall(FUNC func, const ARGS &...args)
+                : _func(std::move(func)),
+                  _args(args...)
+            {
+            }
+
+            decltype(auto) operator()()
+            {
+                return invoke(std::index_sequence_for<ARGS...>());
+            }
+        };
+
+        template <typename FUNC>
+        struct BindMaker
+        {
+            FUNC func;
+
+            template <typename... ARGS>
+            BoundCall<FUNC, std::decay_t<ARGS>...> operator()(const ARGS &...args) const
+            {
+                return BoundCall<FUNC, std::decay_t<ARGS>...>(func, args...);
+            }
+        };
+    }
+
+    // A task for an executor, timed from its creation to its end, the wait for a worker is written apart
+    // Exceptions are recorded and passed on to the executor
+    template <typename FUNC, typename... ARGS>
+    class TimedTask
+    {
+    private:
+        typedef detail::PendingCall<DefaultClock> Pending;
+
+        detail::BoundCall<FUNC, ARGS...> _call;
+        std::shared_ptr<Pending> _pending;
+
+    public:
+        TimedTask(const CallSite &site, FUNC func, const ARGS &...args)
+            : _call(std::move(func), args...),
+              _pending(std::make_shared<Pending>(site))
+        {
+            if (_pending->timed())
+                _pending->arm("Task was never run", args...);
+            _pending->detach();
+        }
+
+        decltype(auto) operator()()
+        {
+            if (!_pending->timed())
+                return _call();
+            _pending->started();
+            try
+            {
+                return detail::completeCall(*_pending, _call);
+            }
+            catch (const std::exception &ex)
+            {
+                _pending->fail(EventKind::Failure, ex.what());
+                throw;
+            }
+            catch (...)
+            {
+                _pending->fail(EventKind::Fatal);
+                throw;
+            }
+        }
+    };
+
+    namespace detail
+    {
+        template <typename FUNC>
+        struct TaskMaker
+        {
+            const CallSite &site;
+            FUNC func;
+
+            template <typename... ARGS>
+            TimedTask<FUNC, std::decay_t<ARGS>...> operator()(const ARGS &...args) const
+            {
+                return TimedTask<FUNC, std::decay_t<ARGS>...>(site, func, args...);
+            }
+        };
+    }
+
+    // Builders of STASK, the arguments follow in a second call so that there may be none
+    template <typename FUNC>
+    detail::TaskMaker<FUNC> makeTimedTask(const CallSite &site, FUNC func)
+    {
+        return detail::TaskMaker<FUNC>{site, func};
+    }
+
+    template <typename FUNC>
+    detail::BindMaker<FUNC> makeTask(FUNC func)
+    {
+        return detail::BindMaker<FUNC>{func};
+    }
+}
+
+// Expression yielding the CallSite of the current source line
+#define SLOG_CALL_SITE(func_name, args_name)                                           \
+    ([]() -> const slog::CallSite & {                                                  \
+        static const slog::CallSite site = {func_name, __FILE__, args_name, __LINE__}; \
+        return site;                                                                   \
+    }())
+
+// Return NaN of the different types, one small specialization per kind of type
+// Add and Update as needed
+template <typename T, typename = void>
+struct NaNValue
+{
+    static constexpr T get()
+    {
+        return T(); // nullptr, false and default constructed values
+    }
+};
+
+template <typename T>
+struct NaNValue<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+{
+    static constexpr T get()
+    {
+        return std::numeric_limits<T>::min();
+    }
+};
+
+template <typename T>
+struct NaNValue<T, std::enable_if_t<std::is_floating_point<T>::value>>
+{
+    static constexpr T get()
+    {
+        return std::numeric_limits<T>::quiet_NaN();
+    }
+};
+
+template <>
+struct NaNValue<CPLErr>
+{
+    static constexpr CPLErr get()
+    {
+        return CE_Failure;
+    }
+};
+
+template <typename T>
+constexpr T NaN()
+{
+    return NaNValue<T>::get();
+}
+
+// Whether a single value equals its NaN, std::isnan for floating types since NaN never compares equal
+namespace slog
+{
+    template <typename T>
+    bool isInvalid(const T &value)
+    {
+        return value == NaN<T>();
+    }
+
+    inline bool isInvalid(float value)
+    {
+        return std::isnan(value);
+    }
+
+    inline bool isInvalid(double value)
+    {
+        return std::isnan(value);
+    }
+
+    inline bool isInvalid(long double value)
+    {
+        return std::isnan(value);
+    }
+}
+
+// SSE2 is part of x86-64, AVX2 is compiled for its own functions and picked at runtime
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SLOG_HAS_SSE2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define SLOG_HAS_AVX2
+#define SLOG_AVX2_TARGET
+#elif defined(__GNUC__)
+#define SLOG_HAS_AVX2
+#define SLOG_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace slog
+{
+    // Outcome of VALIDATE_ARGUMENT for a value or a contiguous range
+    struct Validation
+    {
+        size_t invalid; // Bad elements, 0 when the argument is fine
+        size_t first;   // Index of the first bad element, size when there is none
+        size_t size;    // Elements checked, 0 for a single value or an empty range
+    };
+
+    // Code used for ranges of float and double, other element types are always checked one by one
+    enum class ValidationKernel
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    // A contiguous range for VALIDATE_ARGUMENT, elements equal to sentinel are bad as well as NaN and Inf
+    // For integers the sentinel takes the place of NaN<T>()
+    template <typename T>
+    struct Span
+    {
+        const T *ptr;
+        size_t count;
+        T sentinel;
+
+        const T *data() const
+        {
+            return ptr;
+        }
+
+        size_t size() const
+        {
+            return count;
+        }
+    };
+
+    namespace detail
+    {
+        // Elements checked in bulk, characters and bool keep the comparison of the whole container
+        template <typename E>
+        struct BulkElement
+            : std::integral_constant<bool, std::is_floating_point<E>::value ||
+                                               (std::is_integral<E>::value && !std::is_same<E, bool>::value &&
+                                                !std::is_same<E, char>::value && !std::is_same<E, signed char>::value &&
+                                                !std::is_same<E, unsigned char>::value &&
+                                                !std::is_same<E, wchar_t>::value && !std::is_same<E, char16_t>::value &&
+                                                !std::is_same<E, char32_t>::value)>
+        {
+        };
 
-#ifdef CPL_ERROR_H_INCLUDED // Use CPLError
+        template <typename T>
+        using ElementOf = std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<const T &>().data())>>;
 
-#include <cpl_error.h>
-#define SINFO CPLError
+        template <typename T, typename = void>
+        struct IsBulk : std::false_type
+        {
+        };
 
-#else // Use custom error
+        template <typename T>
+        struct IsBulk<T, VoidT<ElementOf<T>, decltype(std::declval<const T &>().size())>> : BulkElement<ElementOf<T>>
+        {
+        };
 
-#include <mutex>
+        // Sentinel of a range without one, never equal to a floating value
+        template <typename T>
+        constexpr T noSentinel()
+        {
+            return NaN<T>();
+        }
 
-static std::mutex oAllMutex;
+        inline bool isBad(float value, float sentinel)
+        {
+            return !(std::fabs(value) <= std::numeric_limits<float>::max()) || value == sentinel;
+        }
 
-#define SLOCK oAllMutex.lock()
-#define SUNLOCK oAllMutex.unlock()
+        inline bool isBad(double value, double sentinel)
+        {
+            return !(std::fabs(value) <= std::numeric_limits<double>::max()) || value == sentinel;
+        }
 
-typedef enum
-{
-    CE_None = 0,
-    CE_Debug = 1,
-    CE_Warning = 2,
-    CE_Failure = 3,
-    CE_Fatal = 4
-} CPLErr;
+        inline bool isBad(long double value, long double sentinel)
+        {
+            return !(std::fabs(value) <= std::numeric_limits<long double>::max()) || value == sentinel;
+        }
 
-typedef enum
-{
-    CPLE_None,
-    CPLE_AppDefined,
-    CPLE_OutOfMemory,
-    CPLE_FileIO,
-    CPLE_OpenFailed,
-    CPLE_IllegalArg,
-    CPLE_NotSupported,
-    CPLE_AssertionFailed,
-    CPLE_NoWriteAccess,
-    CPLE_UserInterrupt,
-    CPLE_ObjectNull,
-    CPLE_HttpResponse,
-    CPLE_AWSBucketNotFound,
-    CPLE_AWSObjectNotFound,
-    CPLE_AWSAccessDenied,
-    CPLE_AWSInvalidCredentials,
-    CPLE_AWSSignatureDoesNotMatch,
-} CPLErrorNum;
+        template <typename T>
+        bool isBad(T value, T sentinel)
+        {
+            return value == sentinel;
+        }
 
-#define SINFO(eErrClass, err_no, ...) \
-    {                                 \
-        SLOCK;                        \
-        fprintf(stderr, __VA_ARGS__); \
-        fprintf(stderr, "\n");        \
-        if (eErrClass == CE_Fatal)    \
-            exit(1);                  \
-        SUNLOCK;                      \
-    }                                 \
-    while (0)
+        // Elements from offset on, the tail of the vector kernels and the whole range without them
+        template <typename T>
+        void validateScalar(const T *data, size_t offset, size_t size, T sentinel, Validation &result)
+        {
+            for (size_t i = offset; i < size; ++i)
+            {
+                if (isBad(data[i], sentinel))
+                {
+                    if (result.invalid++ == 0)
+                        result.first = i;
+                }
+            }
+        }
 
-#endif // CPL_ERROR_H_INCLUDED
+        // Adds the lanes set in a compare mask, the slow path only taken by blocks with a bad element
+        inline void addMask(unsigned mask, size_t base, Validation &result)
+        {
+            for (size_t lane = 0; mask != 0; ++lane, mask >>= 1)
+            {
+                if ((mask & 1) != 0 && result.invalid++ == 0)
+                    result.first = base + lane;
+            }
+        }
 
-// Get current time
-static std::string nowTimeStr()
-{
-    std::time_t t = std::time(nullptr);
-    char buffer[20];
-    std::strftime(buffer,
-                  sizeof(buffer),
-                  "%Y/%m/%d %H:%M:%S",
-                  std::localtime(&t));
-    return std::string(buffer);
-}
+#ifdef SLOG_HAS_SSE2
+        // |x| > max is true for Inf and, being unordered, for NaN
+        inline __m128d badLanes(__m128d value, __m128d sign, __m128d max, __m128d sentinel)
+        {
+            return _mm_or_pd(_mm_cmpnle_pd(_mm_andnot_pd(sign, value), max), _mm_cmpeq_pd(value, sentinel));
+        }
 
-/*
- @ author:   Garcia6l20
- @ refrence: https://github.com/Garcia6l20/if_constexpr14
- */
-namespace ic
-{
-    namespace detail
-    {
-        template <bool result, typename CaseT>
-        struct case_constexpr
+        inline __m128 badLanes(__m128 value, __m128 sign, __m128 max, __m128 sentinel)
         {
-            static constexpr bool value = result;
-            CaseT case_;
-            constexpr explicit case_constexpr(CaseT &&case_)
-                : case_{std::move(case_)} {}
-            constexpr auto operator()()
+            return _mm_or_ps(_mm_cmpnle_ps(_mm_andnot_ps(sign, value), max), _mm_cmpeq_ps(value, sentinel));
+        }
+
+        // Four vectors per step, their masks are only looked at one by one when the block has a bad element
+        inline void validateSse2(const double *data, size_t size, double sentinel, Validation &result)
+        {
+            const __m128d sign = _mm_set1_pd(-0.0);
+            const __m128d max = _mm_set1_pd(std::numeric_limits<double>::max());
+            const __m128d bad = _mm_set1_pd(sentinel);
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8)
             {
-                return case_();
+                __m128d m0 = badLanes(_mm_loadu_pd(data + i), sign, max, bad);
+                __m128d m1 = badLanes(_mm_loadu_pd(data + i + 2), sign, max, bad);
+                __m128d m2 = badLanes(_mm_loadu_pd(data + i + 4), sign, max, bad);
+                __m128d m3 = badLanes(_mm_loadu_pd(data + i + 6), sign, max, bad);
+                if (_mm_movemask_pd(_mm_or_pd(_mm_or_pd(m0, m1), _mm_or_pd(m2, m3))) != 0)
+                {
+                    addMask(static_cast<unsigned>(_mm_movemask_pd(m0)), i, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_pd(m1)), i + 2, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_pd(m2)), i + 4, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_pd(m3)), i + 6, result);
+                }
             }
-        };
+            validateScalar(data, i, size, sentinel, result);
+        }
+
+        inline void validateSse2(const float *data, size_t size, float sentinel, Validation &result)
+        {
+            const __m128 sign = _mm_set1_ps(-0.0f);
+            const __m128 max = _mm_set1_ps(std::numeric_limits<float>::max());
+            const __m128 bad = _mm_set1_ps(sentinel);
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m128 m0 = badLanes(_mm_loadu_ps(data + i), sign, max, bad);
+                __m128 m1 = badLanes(_mm_loadu_ps(data + i + 4), sign, max, bad);
+                __m128 m2 = badLanes(_mm_loadu_ps(data + i + 8), sign, max, bad);
+                __m128 m3 = badLanes(_mm_loadu_ps(data + i + 12), sign, max, bad);
+                if (_mm_movemask_ps(_mm_or_ps(_mm_or_ps(m0, m1), _mm_or_ps(m2, m3))) != 0)
+                {
+                    addMask(static_cast<unsigned>(_mm_movemask_ps(m0)), i, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_ps(m1)), i + 4, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_ps(m2)), i + 8, result);
+                    addMask(static_cast<unsigned>(_mm_movemask_ps(m3)), i + 12, result);
+                }
+            }
+            validateScalar(data, i, size, sentinel, result);
+        }
+#endif
+
+#ifdef SLOG_HAS_AVX2
+        SLOG_AVX2_TARGET inline __m256d badLanes(__m256d value, __m256d sign, __m256d max, __m256d sentinel)
+        {
+            return _mm256_or_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, value), max, _CMP_NLE_UQ),
+                                _mm256_cmp_pd(value, sentinel, _CMP_EQ_OQ));
+        }
+
+        SLOG_AVX2_TARGET inline __m256 badLanes(__m256 value, __m256 sign, __m256 max, __m256 sentinel)
+        {
+            return _mm256_or_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, value), max, _CMP_NLE_UQ),
+                                _mm256_cmp_ps(value, sentinel, _CMP_EQ_OQ));
+        }
+
+        SLOG_AVX2_TARGET inline void validateAvx2(const double *data, size_t size, double sentinel,
+                                                  Validation &result)
+        {
+            const __m256d sign = _mm256_set1_pd(-0.0);
+            const __m256d max = _mm256_set1_pd(std::numeric_limits<double>::max());
+            const __m256d bad = _mm256_set1_pd(sentinel);
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16)
+            {
+                __m256d m0 = badLanes(_mm256_loadu_pd(data + i), sign, max, bad);
+                __m256d m1 = badLanes(_mm256_loadu_pd(data + i + 4), sign, max, bad);
+                __m256d m2 = badLanes(_mm256_loadu_pd(data + i + 8), sign, max, bad);
+                __m256d m3 = badLanes(_mm256_loadu_pd(data + i + 12), sign, max, bad);
+                if (_mm256_movemask_pd(_mm256_or_pd(_mm256_or_pd(m0, m1), _mm256_or_pd(m2, m3))) != 0)
+                {
+                    addMask(static_cast<unsigned>(_mm256_movemask_pd(m0)), i, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_pd(m1)), i + 4, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_pd(m2)), i + 8, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_pd(m3)), i + 12, result);
+                }
+            }
+            validateScalar(data, i, size, sentinel, result);
+        }
+
+        SLOG_AVX2_TARGET inline void validateAvx2(const float *data, size_t size, float sentinel, Validation &result)
+        {
+            const __m256 sign = _mm256_set1_ps(-0.0f);
+            const __m256 max = _mm256_set1_ps(std::numeric_limits<float>::max());
+            const __m256 bad = _mm256_set1_ps(sentinel);
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32)
+            {
+                __m256 m0 = badLanes(_mm256_loadu_ps(data + i), sign, max, bad);
+                __m256 m1 = badLanes(_mm256_loadu_ps(data + i + 8), sign, max, bad);
+                __m256 m2 = badLanes(_mm256_loadu_ps(data + i + 16), sign, max, bad);
+                __m256 m3 = badLanes(_mm256_loadu_ps(data + i + 24), sign, max, bad);
+                if (_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(m0, m1), _mm256_or_ps(m2, m3))) != 0)
+                {
+                    addMask(static_cast<unsigned>(_mm256_movemask_ps(m0)), i, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_ps(m1)), i + 8, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_ps(m2)), i + 16, result);
+                    addMask(static_cast<unsigned>(_mm256_movemask_ps(m3)), i + 24, result);
+                }
+            }
+            validateScalar(data, i, size, sentinel, result);
+        }
+
+        inline bool cpuHasAvx2()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7)
+                return false;
+            __cpuid(info, 1);
+            // AVX registers saved by the OS, then the AVX2 bit itself
+            if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        }
+#endif
+
+        inline ValidationKernel bestKernel()
+        {
+#ifdef SLOG_HAS_AVX2
+            static const bool avx2 = cpuHasAvx2();
+            if (avx2)
+                return ValidationKernel::Avx2;
+#endif
+#ifdef SLOG_HAS_SSE2
+            return ValidationKernel::Sse2;
+#else
+            return ValidationKernel::Scalar;
+#endif
+        }
+
+        inline std::atomic<int> &validationKernel()
+        {
+            static std::atomic<int> kernel(static_cast<int>(bestKernel()));
+            return kernel;
+        }
+
+        template <typename T>
+        void validateRange(const T *data, size_t size, T sentinel, Validation &result)
+        {
+            validateScalar(data, 0, size, sentinel, result);
+        }
+
+        // float and double go to the selected kernel
+        template <typename T>
+        void validateVector(const T *data, size_t size, T sentinel, Validation &result)
+        {
+            switch (static_cast<ValidationKernel>(validationKernel().load(std::memory_order_relaxed)))
+            {
+#ifdef SLOG_HAS_AVX2
+            case ValidationKernel::Avx2:
+                validateAvx2(data, size, sentinel, result);
+                return;
+#endif
+#ifdef SLOG_HAS_SSE2
+            case ValidationKernel::Sse2:
+                validateSse2(data, size, sentinel, result);
+                return;
+#endif
+            default:
+                validateScalar(data, 0, size, sentinel, result);
+            }
+        }
+
+        inline void validateRange(const float *data, size_t size, float sentinel, Validation &result)
+        {
+            validateVector(data, size, sentinel, result);
+        }
+
+        inline void validateRange(const double *data, size_t size, double sentinel, Validation &result)
+        {
+            validateVector(data, size, sentinel, result);
+        }
     }
 
-    template <bool result, typename CaseT>
-    constexpr auto case_(CaseT &&case_)
+    // Kernel used from now on, false if the CPU can not run it
+    inline bool setValidationKernel(ValidationKernel kernel)
     {
-        return detail::case_constexpr<result, CaseT>{std::forward<CaseT>(case_)};
+        if (static_cast<int>(kernel) > static_cast<int>(detail::bestKernel()))
+            return false;
+        detail::validationKernel().store(static_cast<int>(kernel), std::memory_order_relaxed);
+        return true;
     }
 
-    template <typename DefaultT>
-    constexpr auto default_(DefaultT &&default_)
+    inline ValidationKernel validationKernel()
     {
-        return detail::case_constexpr<true, DefaultT>{std::forward<DefaultT>(default_)};
+        return static_cast<ValidationKernel>(detail::validationKernel().load(std::memory_order_relaxed));
     }
 
-    template <typename LastT,
-              std::enable_if_t<LastT::value, int> = 0>
-    constexpr auto switch_(LastT &&last)
+    inline const char *kernelName(ValidationKernel kernel)
     {
-        return last();
+        switch (kernel)
+        {
+        case ValidationKernel::Scalar:
+            return "scalar";
+        case ValidationKernel::Sse2:
+            return "sse2";
+        case ValidationKernel::Avx2:
+            return "avx2";
+        }
+        return "unknown";
     }
 
-    template <typename LastT,
-              std::enable_if_t<!LastT::value, int> = 0>
-    constexpr auto switch_(LastT &&last)
+    template <typename T>
+    Span<T> span(const T *data, size_t size, T sentinel = detail::noSentinel<T>())
     {
+        return Span<T>{data, size, sentinel};
     }
 
-    template <typename FirstT, typename... CasesT,
-              std::enable_if_t<FirstT::value, int> = 0>
-    constexpr auto switch_(FirstT &&first, CasesT &&...cases)
+    template <typename C>
+    auto span(const C &range) -> Span<detail::ElementOf<C>>
     {
-        return first();
+        return Span<detail::ElementOf<C>>{range.data(), range.size(), detail::noSentinel<detail::ElementOf<C>>()};
     }
 
-    template <typename FirstT, typename... CasesT,
-              std::enable_if_t<!FirstT::value, int> = 0>
-    constexpr auto switch_(FirstT &&first, CasesT &&...cases)
+    template <typename C>
+    auto span(const C &range, detail::ElementOf<C> sentinel) -> Span<detail::ElementOf<C>>
     {
-        return switch_<CasesT...>(std::forward<CasesT>(cases)...);
+        return Span<detail::ElementOf<C>>{range.data(), range.size(), sentinel};
     }
-}
 
-// Return NaN of the different types
-// Add and Update as needed
-template <typename T>
-constexpr T NaN()
-{
-    return ic::switch_(
-        ic::case_<std::is_pointer<T>::value>(
-            []
-            { return nullptr; }),
-        ic::case_<std::is_same<T, CPLErr>::value>(
-            []
-            { return CE_Failure; }),
-        ic::case_<std::is_same<T, bool>::value>(
-            []
-            { return false; }),
-        ic::case_<std::is_same<T, char>::value>(
-            []
-            { return std::numeric_limits<char>::min(); }),
-        ic::case_<std::is_same<T, signed char>::value>(
-            []
-            { return std::numeric_limits<signed char>::min(); }),
-        ic::case_<std::is_same<T, unsigned char>::value>(
-            []
-            { return std::numeric_limits<unsigned char>::min(); }),
-        ic::case_<std::is_same<T, wchar_t>::value>(
-            []
-            { return std::numeric_limits<wchar_t>::min(); }),
-        ic::case_<std::is_same<T, char16_t>::value>(
-            []
-            { return std::numeric_limits<char16_t>::min(); }),
-        ic::case_<std::is_same<T, char32_t>::value>(
-            []
-            { return std::numeric_limits<char32_t>::min(); }),
-        ic::case_<std::is_same<T, short>::value>(
-            []
-            { return std::numeric_limits<short>::min(); }),
-        ic::case_<std::is_same<T, unsigned short>::value>(
-            []
-            { return std::numeric_limits<unsigned short>::min(); }),
-        ic::case_<std::is_same<T, int>::value>(
-            []
-            { return std::numeric_limits<int>::min(); }),
-        ic::case_<std::is_same<T, unsigned int>::value>(
-            []
-            { return std::numeric_limits<unsigned int>::min(); }),
-        ic::case_<std::is_same<T, long>::value>(
-            []
-            { return std::numeric_limits<long>::min(); }),
-        ic::case_<std::is_same<T, unsigned long>::value>(
-            []
-            { return std::numeric_limits<unsigned long>::min(); }),
-        ic::case_<std::is_same<T, long long>::value>(
-            []
-            { return std::numeric_limits<long long>::min(); }),
-        ic::case_<std::is_same<T, unsigned long long>::value>(
-            []
-            { return std::numeric_limits<unsigned long long>::min(); }),
-        ic::case_<std::is_same<T, float>::value>(
-            []
-            { return std::numeric_limits<float>::quiet_NaN(); }),
-        ic::case_<std::is_same<T, double>::value>(
-            []
-            { return std::numeric_limits<double>::quiet_NaN(); }),
-        ic::case_<std::is_same<T, long double>::value>(
-            []
-            { return std::numeric_limits<long double>::quiet_NaN(); }),
-        ic::default_(
-            []
-            { return T(); }));
-}
-
-// Select placeholders according to the number of arguments
-// In c++17, it can be replaced by if constexpr
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 0, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 1, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 2, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 3, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 4, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 5, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4,
-                     std::placeholders::_5);
-}
-
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 6, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4,
-                     std::placeholders::_5,
-                     std::placeholders::_6);
-}
+    // An empty range counts as one bad value, like the empty container NaN<T>() stands for
+    template <typename T>
+    Validation validate(const Span<T> &range)
+    {
+        Validation result = {0, range.count, range.count};
+        if (range.count == 0)
+            result.invalid = 1;
+        else
+            detail::validateRange(range.ptr, range.count, range.sentinel, result);
+        return result;
+    }
 
-// Add for const member function
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 0, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
-{
-    return std::bind(func, obj);
-}
+    template <typename T>
+    auto validate(const T &value) -> std::enable_if_t<detail::IsBulk<T>::value, Validation>
+    {
+        return validate(span(value));
+    }
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 1, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1);
-}
+    template <typename T, size_t N>
+    auto validate(const T (&values)[N]) -> std::enable_if_t<detail::BulkElement<T>::value, Validation>
+    {
+        return validate(span(values, N));
+    }
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 2, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2);
-}
+    template <typename T>
+    auto validate(const T &value) -> std::enable_if_t<!detail::IsBulk<T>::value, Validation>
+    {
+        return Validation{isInvalid(value) ? 1u : 0u, 0, 0};
+    }
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 3, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
-{
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3);
+    // Report of a failed VALIDATE_ARGUMENT, ranges tell how many elements are bad and where the first one is
+    inline void reportInvalid(const CallSite &site, const char *arg_name, const Validation &validation)
+    {
+        if (validation.size == 0)
+        {
+            reportFailure(site, EventKind::Action, false, EventKind::Invalid, arg_name);
+            return;
+        }
+        char message[512];
+        std::snprintf(message, sizeof(message),
+                      "Argument '%s' is invalid in %zu of %zu elements, the first at index %zu", arg_name,
+                      validation.invalid, validation.size, validation.first);
+        reportFailure(site, EventKind::Action, false, EventKind::Failure, message);
+    }
 }
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 4, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
+// Bind a member function to its object, no std::bind and std::function involved
+template <typename CLS, typename PMF>
+class MemberFunction
 {
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4);
-}
+private:
+    PMF _func;
+    CLS *_obj;
+
+public:
+    constexpr MemberFunction(PMF func, CLS *obj)
+        : _func(func),
+          _obj(obj)
+    {
+    }
+    template <typename... ARGS>
+    decltype(auto) operator()(ARGS &&...args) const
+    {
+        return (_obj->*_func)(std::forward<ARGS>(args)...);
+    }
+};
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 5, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
+template <typename CLS, typename RET, typename... ARGS>
+constexpr MemberFunction<CLS, RET (CLS::*)(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...), CLS *obj)
 {
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4,
-                     std::placeholders::_5);
+    return MemberFunction<CLS, RET (CLS::*)(ARGS...)>(func, obj);
 }
 
-template <typename CLS, typename RET, typename... ARGS, std::enable_if_t<sizeof...(ARGS) == 6, int> = 1>
-std::function<RET(ARGS...)> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
+// Add for const member function
+template <typename CLS, typename RET, typename... ARGS>
+constexpr MemberFunction<CLS, RET (CLS::*)(ARGS...) const> makePlaceholders(RET (CLS::*func)(ARGS...) const, CLS *obj)
 {
-    return std::bind(func, obj, std::placeholders::_1,
-                     std::placeholders::_2,
-                     std::placeholders::_3,
-                     std::placeholders::_4,
-                     std::placeholders::_5,
-                     std::placeholders::_6);
+    return MemberFunction<CLS, RET (CLS::*)(ARGS...) const>(func, obj);
 }
 
 // Select function according to the return type
-template <typename RET, typename... ARGS, std::enable_if_t<!std::is_same<RET, void>::value, int> = 1>
-RET runFunction(std::function<RET(ARGS...)> func, ARGS... args)
-{
-    auto start_time = std::chrono::high_resolution_clock::now();
-    RET result = func(args...);
-    std::chrono::duration<double> duration =
-        std::chrono::high_resolution_clock::now() - start_time;
-    double ms = duration.count() * 1000.0;
-    SINFO(CE_Debug, CPLE_None, "  [Success]\tIt takes %lf ms", ms);
+// Arguments are forwarded untouched, the result is moved out
+// The duration stays in CLOCK ticks until the record is written
+template <typename RET, typename CLOCK = slog::DefaultClock, typename FUNC, typename... ARGS,
+          std::enable_if_t<!std::is_same<RET, void>::value, int> = 1>
+RET runFunction(slog::CallTrace &trace, const FUNC &func, ARGS &&...args)
+{
+    int64_t start_ticks = trace.startTicks<CLOCK>();
+    RET result = func(std::forward<ARGS>(args)...);
+    int64_t ticks = CLOCK::now() - start_ticks;
+    trace.captureResult(result);
+    trace.succeed(ticks, &CLOCK::toNs);
     return result;
 }
 
-template <typename RET, typename... ARGS, std::enable_if_t<std::is_same<RET, void>::value, int> = 1>
-RET runFunction(std::function<RET(ARGS...)> func, ARGS... args)
+template <typename RET, typename CLOCK = slog::DefaultClock, typename FUNC, typename... ARGS,
+          std::enable_if_t<std::is_same<RET, void>::value, int> = 1>
+RET runFunction(slog::CallTrace &trace, const FUNC &func, ARGS &&...args)
 {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    func(args...);
-    std::chrono::duration<double> duration =
-        std::chrono::high_resolution_clock::now() - start_time;
-    double ms = duration.count() * 1000.0;
-    SINFO(CE_Debug, CPLE_None, "  [Success]\tIt takes %lf ms", ms);
+    int64_t start_ticks = trace.startTicks<CLOCK>();
+    func(std::forward<ARGS>(args)...);
+    trace.succeed(CLOCK::now() - start_ticks, &CLOCK::toNs);
     return void();
 }
 
 // core class of slog
-template <typename>
+// FUNC is called directly, a function pointer for free functions and a MemberFunction for members
+// CLOCK is one of the clock policies, SLOG_CLOCK by default
+template <typename SIG, typename FUNC = SIG *, typename CLOCK = slog::DefaultClock>
 class TimeLog;
 
-template <typename RET, typename... ARGS>
-class TimeLog<RET(ARGS...)>
+template <typename RET, typename... ARGS, typename FUNC, typename CLOCK>
+class TimeLog<RET(ARGS...), FUNC, CLOCK>
 {
 private:
-    std::function<RET(ARGS...)> _func;
-    std::string _func_name;
-    std::string _file_name;
-    std::string _args_name;
-    int _line_no;
+    FUNC _func;
+    const slog::CallSite *_site;
 
 public:
-    constexpr TimeLog(std::function<RET(ARGS...)> func,
-                      const char *func_name,
-                      const char *file_name,
-                      const char *args_name,
-                      int line_no)
+    constexpr TimeLog(FUNC func, const slog::CallSite &site)
         : _func(func),
-          _func_name(func_name),
-          _file_name(file_name),
-          _args_name(args_name),
-          _line_no(line_no)
-    {
-    }
-    template <typename CLS>
-    constexpr TimeLog(RET (CLS::*func)(ARGS...),
-                      CLS *obj,
-                      const char *func_name,
-                      const char *file_name,
-                      const char *args_name,
-                      int line_no)
-        : _func_name(func_name),
-          _file_name(file_name),
-          _args_name(args_name),
-          _line_no(line_no)
-    {
-        _func = makePlaceholders<CLS, RET, ARGS...>(func, obj);
-    }
-    template <typename CLS>
-    constexpr TimeLog(RET (CLS::*func)(ARGS...) const,
-                      CLS *obj,
-                      const char *func_name,
-                      const char *file_name,
-                      const char *args_name,
-                      int line_no)
-        : _func_name(func_name),
-          _file_name(file_name),
-          _args_name(args_name),
-          _line_no(line_no)
-    {
-        _func = makePlaceholders<CLS, RET, ARGS...>(func, obj);
-    }
-    RET operator()(ARGS... args)
-    {
-        SINFO(CE_Debug, CPLE_None, "~ %s", nowTimeStr().c_str());
-        SINFO(CE_Debug, CPLE_None, "  [Function]\t%s(%s)", _func_name.c_str(), _args_name.c_str());
-        SINFO(CE_Debug, CPLE_None, "  [Location]\t%s (%d)", _file_name.c_str(), _line_no);
+          _site(&site)
+    {
+    }
+    // Perfect forwarding, the decorator never copies an argument
+    // A call returning a std::future or taking a std::function last is timed until it completes
+    template <typename... UARGS>
+    RET operator()(UARGS &&...args) const
+    {
+        return call(slog::detail::CompletionOf<RET, ARGS...>(), std::forward<UARGS>(args)...);
+    }
+
+private:
+    typedef slog::detail::PendingCall<CLOCK> Pending;
+
+    template <typename... UARGS>
+    RET call(slog::detail::ReturnCompletion, UARGS &&...args) const
+    {
+        slog::CallTrace trace(*_site, slog::EventKind::Call);
+        slog::detail::CaptureBuffer values;
+        try
+        {
+            if (!trace.timed())
+                return _func(std::forward<UARGS>(args)...);
+            if (trace.capturing())
+            {
+                values.arguments(args...);
+                trace.capture(values);
+            }
+            return runFunction<RET, CLOCK>(trace, _func, std::forward<UARGS>(args)...);
+        }
+        catch (const std::exception &ex)
+        {
+            trace.fail(slog::EventKind::Failure, ex.what());
+            return NaN<RET>();
+        }
+        catch (...)
+        {
+            trace.fail(slog::EventKind::Fatal);
+            return NaN<RET>();
+        }
+    }
+
+    // The returned future is ready once the call is recorded, an invalid future completes at once
+    template <typename... UARGS>
+    RET call(slog::detail::FutureCompletion, UARGS &&...args) const
+    {
+        std::shared_ptr<Pending> pending = std::make_shared<Pending>(*_site);
+        try
+        {
+            if (!pending->timed())
+                return _func(std::forward<UARGS>(args)...);
+            pending->arm(nullptr, args...);
+            RET future;
+            {
+                typename Pending::Launch launch = {*pending};
+                future = _func(std::forward<UARGS>(args)...);
+            }
+            if (!future.valid())
+            {
+                pending->succeed();
+                return future;
+            }
+            return slog::detail::awaitFuture(std::move(future), pending);
+        }
+        catch (const std::exception &ex)
+        {
+            pending->fail(slog::EventKind::Failure, ex.what());
+            return NaN<RET>();
+        }
+        catch (...)
+        {
+            pending->fail(slog::EventKind::Fatal);
+            return NaN<RET>();
+        }
+    }
+
+    // The call ends when its callback is called, from whatever thread, or when it returns without one
+    template <typename... UARGS>
+    RET call(slog::detail::CallbackCompletion, UARGS &&...args) const
+    {
+        std::shared_ptr<Pending> pending = std::make_shared<Pending>(*_site);
         try
         {
-            return runFunction<RET, ARGS...>(_func, args...);
+            if (!pending->timed())
+                return _func(std::forward<UARGS>(args)...);
+            pending->arm("Callback was never called", args...);
+            typename Pending::Launch launch = {*pending};
+            return launchCallback(pending, std::forward_as_tuple(std::forward<UARGS>(args)...),
+                                  std::make_index_sequence<sizeof...(UARGS) - 1>());
         }
         catch (const std::exception &ex)
         {
-            SINFO(CE_Failure, CPLE_AppDefined, "  [Failure]\t%s", ex.what());
+            pending->fail(slog::EventKind::Failure, ex.what());
             return NaN<RET>();
         }
         catch (...)
         {
-            SINFO(CE_Fatal, CPLE_AppDefined, "  [Fatal]\tUnknown exception");
+            pending->fail(slog::EventKind::Fatal);
             return NaN<RET>();
         }
     }
+
+    template <typename TUPLE, size_t... I>
+    RET launchCallback(const std::shared_ptr<Pending> &pending, TUPLE &&args, std::index_sequence<I...>) const
+    {
+        typename slog::detail::LastArg<ARGS...>::type callback(std::get<sizeof...(I)>(std::move(args)));
+        if (!callback)
+            return slog::detail::completeCall(*pending, [&]() -> RET
+                                              { return _func(std::get<I>(std::move(args))..., std::move(callback)); });
+        return _func(std::get<I>(std::move(args))..., slog::detail::completeOnCall(std::move(callback), pending));
+    }
 };
 
 // Make slog function
 template <typename RET, typename... ARGS>
 constexpr TimeLog<RET(ARGS...)> makeTimeLogFunction(RET (*func)(ARGS...),
-                                                    const char *func_name,
-                                                    const char *file_name,
-                                                    const char *args_name,
-                                                    int line_no)
+                                                    const slog::CallSite &site)
 {
-    return TimeLog<RET(ARGS...)>(std::function<RET(ARGS...)>(func),
-                                 func_name,
-                                 file_name,
-                                 args_name,
-                                 line_no);
+    return TimeLog<RET(ARGS...)>(func, site);
 }
 
 template <typename RET, typename CLS, typename... ARGS>
-constexpr TimeLog<RET(ARGS...)> makeTimeLogMemberFunction(RET (CLS::*func)(ARGS...),
-                                                          CLS *obj,
-                                                          const char *func_name,
-                                                          const char *file_name,
-                                                          const char *args_name,
-                                                          int line_no)
+constexpr TimeLog<RET(ARGS...), MemberFunction<CLS, RET (CLS::*)(ARGS...)>>
+makeTimeLogMemberFunction(RET (CLS::*func)(ARGS...),
+                          CLS *obj,
+                          const slog::CallSite &site)
 {
-    return TimeLog<RET(ARGS...)>(func,
-                                 obj,
-                                 func_name,
-                                 file_name,
-                                 args_name,
-                                 line_no);
+    return TimeLog<RET(ARGS...), MemberFunction<CLS, RET (CLS::*)(ARGS...)>>(
+        makePlaceholders<CLS, RET, ARGS...>(func, obj), site);
 }
 
 template <typename RET, typename CLS, typename... ARGS>
-constexpr TimeLog<RET(ARGS...)> makeTimeLogMemberFunction(RET (CLS::*func)(ARGS...) const,
-                                                          CLS *obj,
-                                                          const char *func_name,
-                                                          const char *file_name,
-                                                          const char *args_name,
-                                                          int line_no)
+constexpr TimeLog<RET(ARGS...), MemberFunction<CLS, RET (CLS::*)(ARGS...) const>>
+makeTimeLogMemberFunction(RET (CLS::*func)(ARGS...) const,
+                          CLS *obj,
+                          const slog::CallSite &site)
 {
-    return TimeLog<RET(ARGS...)>(func,
-                                 obj,
-                                 func_name,
-                                 file_name,
-                                 args_name,
-                                 line_no);
+    return TimeLog<RET(ARGS...), MemberFunction<CLS, RET (CLS::*)(ARGS...) const>>(
+        makePlaceholders<CLS, RET, ARGS...>(func, obj), site);
 }
 
+// The TimeLog is built once at decoration time and reused by every call
 template <typename RET, typename... ARGS>
 constexpr auto decorateFunction(RET (*func)(ARGS...),
-                                const char *func_name,
-                                const char *file_name,
-                                int line_no)
+                                const slog::CallSite &site)
 {
-    return [=](ARGS... args) -> RET
+    auto log = makeTimeLogFunction(func, site);
+    return [log](auto &&...args) -> RET
     {
-        return makeTimeLogFunction(func, func_name, file_name, "...", line_no)(args...);
+        return log(std::forward<decltype(args)>(args)...);
     };
 }
 
 template <typename RET, typename CLS, typename... ARGS>
 constexpr auto decorateMemberFunction(RET (CLS::*func)(ARGS...),
                                       CLS *obj,
-                                      const char *func_name,
-                                      const char *file_name,
-                                      int line_no)
+                                      const slog::CallSite &site)
 {
-    return [=](ARGS... args) -> RET
+    auto log = makeTimeLogMemberFunction(func, obj, site);
+    return [log](auto &&...args) -> RET
     {
-        return makeTimeLogMemberFunction(func, obj, func_name, file_name, "...", line_no)(args...);
+        return log(std::forward<decltype(args)>(args)...);
     };
 }
 
 template <typename RET, typename CLS, typename... ARGS>
 constexpr auto decorateMemberFunction(RET (CLS::*func)(ARGS...) const,
                                       CLS *obj,
-                                      const char *func_name,
-                                      const char *file_name,
-                                      int line_no)
+                                      const slog::CallSite &site)
 {
-    return [=](ARGS... args) -> RET
+    auto log = makeTimeLogMemberFunction(func, obj, site);
+    return [log](auto &&...args) -> RET
     {
-        return makeTimeLogMemberFunction(func, obj, func_name, file_name, "...", line_no)(args...);
+        return log(std::forward<decltype(args)>(args)...);
     };
 }
 
-inline const char *actLog(const char *func_name, const char *file_name, int line_no)
+inline const char *actLog(const slog::CallSite &site)
 {
-    SINFO(CE_Debug, CPLE_None, "- %s", nowTimeStr().c_str());
-    SINFO(CE_Debug, CPLE_None, "  [Function]\t%s", func_name);
-    SINFO(CE_Debug, CPLE_None, "  [Location]\t%s (%d)", file_name, line_no);
-    return func_name;
+    if (slog::detail::FlightMap *flight = slog::flightRecorder().map())
+        slog::detail::flightEvent(*flight, slog::EventKind::Action, site, slog::wallTime(), 0);
+    if (slog::shouldLog(CE_Debug, site))
+        slog::logEvent(slog::EventKind::Action, site);
+    return site.func_name;
 }
 
-#define VALIDATE_ARGUMENT0(arg, func)                                                \
-    do                                                                               \
-    {                                                                                \
-        if (arg == NaN<decltype(arg)>())                                             \
-        {                                                                            \
-            SINFO(CE_Debug, CPLE_None, "- %s", nowTimeStr().c_str());                \
-            SINFO(CE_Debug, CPLE_None, "  [Function]\t%s", func);                    \
-            SINFO(CE_Debug, CPLE_None, "  [Location]\t%s (%d)", __FILE__, __LINE__); \
-            SINFO(CE_Failure, CPLE_NotSupported,                                     \
-                  "  [Failure]\tArgument \'%s\' is NaN", #arg);                      \
-            return;                                                                  \
-        }                                                                            \
+#define VALIDATE_ARGUMENT0(arg, func)                                                          \
+    do                                                                                         \
+    {                                                                                          \
+        slog::Validation slog_validation = slog::validate(arg);                                \
+        if (slog_validation.invalid != 0)                                                      \
+        {                                                                                      \
+            static const slog::CallSite slog_check_site = {func, __FILE__, nullptr, __LINE__}; \
+            slog::reportInvalid(slog_check_site, #arg, slog_validation);                       \
+            return;                                                                            \
+        }                                                                                      \
     } while (0)
 
-#define VALIDATE_ARGUMENT1(arg, func, ret)                                           \
-    do                                                                               \
-    {                                                                                \
-        if (arg == NaN<decltype(arg)>())                                             \
-        {                                                                            \
-            SINFO(CE_Debug, CPLE_None, "- %s", nowTimeStr().c_str());                \
-            SINFO(CE_Debug, CPLE_None, "  [Function]\t%s", func);                    \
-            SINFO(CE_Debug, CPLE_None, "  [Location]\t%s (%d)", __FILE__, __LINE__); \
-            SINFO(CE_Failure, CPLE_NotSupported,                                     \
-                  "  [Failure]\tArgument \'%s\' is NaN", #arg);                      \
-            return ret;                                                              \
-        }                                                                            \
+#define VALIDATE_ARGUMENT1(arg, func, ret)                                                     \
+    do                                                                                         \
+    {                                                                                          \
+        slog::Validation slog_validation = slog::validate(arg);                                \
+        if (slog_validation.invalid != 0)                                                      \
+        {                                                                                      \
+            static const slog::CallSite slog_check_site = {func, __FILE__, nullptr, __LINE__}; \
+            slog::reportInvalid(slog_check_site, #arg, slog_validation);                       \
+            return ret;                                                                        \
+        }                                                                                      \
     } while (0)
 
-#ifdef _ENABLE_SLOG
+#if defined(_ENABLE_SLOG) && SLOG_ACTIVE_LEVEL <= 4
 
-#define SENTRY                                                               \
-    SINFO(CE_Debug, CPLE_None, "- %s", nowTimeStr().c_str());                \
-    SINFO(CE_Debug, CPLE_None, "  [Function]\t%s", __FUNCTION__);            \
-    SINFO(CE_Debug, CPLE_None, "  [Location]\t%s (%d)", __FILE__, __LINE__); \
-    try                                                                      \
+// SLEAVE reports failures through the scope declared by SENTRY
+#define SENTRY                                                                                 \
+    static const slog::CallSite slog_entry_site = {__FUNCTION__, __FILE__, nullptr, __LINE__}; \
+    slog::EntryScope slog_entry_scope(slog_entry_site);                                        \
+    try                                                                                        \
     {
 
-#define SLEAVE(ret)                                                       \
-    }                                                                     \
-    catch (const std::exception &ex)                                      \
-    {                                                                     \
-        SINFO(CE_Failure, CPLE_AppDefined, "  [Failure]\t%s", ex.what()); \
-        return ret;                                                       \
-    }                                                                     \
-    catch (...)                                                           \
-    {                                                                     \
-        SINFO(CE_Fatal, CPLE_AppDefined, "  [Fatal]\tUnknown exception"); \
-        return ret;                                                       \
+#define SLEAVE(ret)                                                 \
+    }                                                               \
+    catch (const std::exception &ex)                                \
+    {                                                               \
+        slog_entry_scope.fail(slog::EventKind::Failure, ex.what()); \
+        return ret;                                                 \
+    }                                                               \
+    catch (...)                                                     \
+    {                                                               \
+        slog_entry_scope.fail(slog::EventKind::Fatal);              \
+        return ret;                                                 \
     }
 
-#define SFUNC_DEC(func) decorateFunction(&func, #func, __FILE__, __LINE__)
+#define SLOG_CONCAT_(a, b) a##b
+#define SLOG_CONCAT(a, b) SLOG_CONCAT_(a, b)
+
+// Times the rest of the enclosing block as name, without the try of SENTRY
+#define SSCOPE(name)                                                                             \
+    static const slog::CallSite SLOG_CONCAT(slog_scope_site_, __LINE__) = {                      \
+        name, __FILE__, nullptr, __LINE__};                                                      \
+    slog::EntryScope SLOG_CONCAT(slog_scope_, __LINE__)(SLOG_CONCAT(slog_scope_site_, __LINE__))
+
+#define SFUNC_DEC(func) decorateFunction(&func, SLOG_CALL_SITE(#func, "..."))
+
+#define SFUNC_MEM_DEC(obj, func) decorateMemberFunction(&func, &obj, SLOG_CALL_SITE(#func, "..."))
 
-#define SFUNC_MEM_DEC(obj, func) decorateMemberFunction(&func, &obj, #func, __FILE__, __LINE__)
+#define SFUNC_DEC_SAMPLED(func, sampling) \
+    decorateFunction(&func, slog::sampleSite(SLOG_CALL_SITE(#func, "..."), sampling))
+
+#define SFUNC_MEM_DEC_SAMPLED(obj, func, sampling) \
+    decorateMemberFunction(&func, &obj, slog::sampleSite(SLOG_CALL_SITE(#func, "..."), sampling))
 
 #define SFUNC_RUN(func, ...) \
-    makeTimeLogFunction(func, #func, __FILE__, #__VA_ARGS__, __LINE__)(__VA_ARGS__)
+    makeTimeLogFunction(func, SLOG_CALL_SITE(#func, #__VA_ARGS__))(__VA_ARGS__)
 
 #define SFUNC_MEM_RUN(obj, func, ...) \
-    makeTimeLogMemberFunction(&func, &obj, #func, __FILE__, #__VA_ARGS__, __LINE__)(__VA_ARGS__)
+    makeTimeLogMemberFunction(&func, &obj, SLOG_CALL_SITE(#func, #__VA_ARGS__))(__VA_ARGS__)
+
+// A task calling func with copies of the arguments, for an executor or a std::packaged_task
+#define STASK(func, ...) slog::makeTimedTask(SLOG_CALL_SITE(#func, #__VA_ARGS__), func)(__VA_ARGS__)
 
-#define SACTION(action) ((void)actLog(#action, __FILE__, __LINE__), (action))
+#if SLOG_ACTIVE_LEVEL <= 1
+#define SACTION(action) ((void)actLog(SLOG_CALL_SITE(#action, nullptr)), (action))
+#else
+#define SACTION(action) action
+#endif
 
 #else
 
 #define SENTRY
 #define SLEAVE(result)
+#define SSCOPE(name)
 #define SFUNC_DEC(func) func
 #define SFUNC_MEM_DEC(obj, func) makePlaceholders(&func, &obj)
+#define SFUNC_DEC_SAMPLED(func, sampling) func
+#define SFUNC_MEM_DEC_SAMPLED(obj, func, sampling) makePlaceholders(&func, &obj)
 #define SFUNC_RUN(func, ...) func(__VA_ARGS__)
-#define SFUNC_MEM_RUN(obj, func, ...) std::bind(&func, &obj, __VA_ARGS__)()
+#define SFUNC_MEM_RUN(obj, func, ...) makePlaceholders(&func, &obj)(__VA_ARGS__)
+#define STASK(func, ...) slog::makeTask(func)(__VA_ARGS__)
 #define SACTION(action) action
 
 #endif // _ENABLE_SLOG
 
+// Global operator new and delete counting the allocations of each thread, define in one source file only
+#ifdef SLOG_ALLOCATION_HOOKS
+
+// Memory from operator new is given back with free on purpose, both ends are replaced here
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace slog
+{
+    namespace detail
+    {
+        inline void *hookedAllocate(size_t size)
+        {
+            void *ptr = std::malloc(size != 0 ? size : 1);
+            countAllocation(ptr);
+            return ptr;
+        }
+
+        inline void hookedFree(void *ptr)
+        {
+            countFree(ptr);
+            std::free(ptr);
+        }
+
+        static const bool kAllocationHooks = (allocationHooks().store(true), true);
+    }
+}
+
+void *operator new(size_t size)
+{
+    void *ptr;
+    while ((ptr = slog::detail::hookedAllocate(size)) == nullptr)
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+            throw std::bad_alloc();
+        handler();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return slog::detail::hookedAllocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return slog::detail::hookedAllocate(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+    slog::detail::hookedFree(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SLOG_ALLOCATION_HOOKS
+
 #endif // _SLOG_H_
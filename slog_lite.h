@@ -0,0 +1,429 @@
+/*
+ @ brief:   Front end of slog for code linked against the slog library
+            Only the macros, the call sites and a scope timer are compiled in each file,
+            sinks, formatting and time code are built once into the library
+ */
+
+#ifndef _SLOG_LITE_H_
+#define _SLOG_LITE_H_
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#ifdef CPL_ERROR_H_INCLUDED // Use CPLError
+
+#include <cpl_error.h>
+
+#elif !defined(SLOG_CPL_ERROR_DEFINED) // Use custom error, shared with slog.h
+#define SLOG_CPL_ERROR_DEFINED
+
+typedef enum
+{
+    CE_None = 0,
+    CE_Debug = 1,
+    CE_Warning = 2,
+    CE_Failure = 3,
+    CE_Fatal = 4
+} CPLErr;
+
+typedef enum
+{
+    CPLE_None,
+    CPLE_AppDefined,
+    CPLE_OutOfMemory,
+    CPLE_FileIO,
+    CPLE_OpenFailed,
+    CPLE_IllegalArg,
+    CPLE_NotSupported,
+    CPLE_AssertionFailed,
+    CPLE_NoWriteAccess,
+    CPLE_UserInterrupt,
+    CPLE_ObjectNull,
+    CPLE_HttpResponse,
+    CPLE_AWSBucketNotFound,
+    CPLE_AWSObjectNotFound,
+    CPLE_AWSAccessDenied,
+    CPLE_AWSInvalidCredentials,
+    CPLE_AWSSignatureDoesNotMatch,
+} CPLErrorNum;
+
+#endif // CPL_ERROR_H_INCLUDED
+
+// Exported by the shared library, SLOG_SHARED is set by the slog target for its users
+#if defined(_WIN32) && defined(SLOG_SHARED)
+#ifdef SLOG_EXPORTS
+#define SLOG_API __declspec(dllexport)
+#else
+#define SLOG_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define SLOG_API __attribute__((visibility("default")))
+#else
+#define SLOG_API
+#endif
+
+#if defined(__GNUC__)
+#define SLOG_PRINTF(format_index, first_arg) __attribute__((format(printf, format_index, first_arg)))
+#else
+#define SLOG_PRINTF(format_index, first_arg)
+#endif
+
+#ifndef SLOG_LITE_SCOPE_SIZE
+#define SLOG_LITE_SCOPE_SIZE 256 // Bytes kept in a Scope for the library's timer, checked when the library is built
+#endif
+
+#ifndef SLOG_ACTIVE_LEVEL
+#define SLOG_ACTIVE_LEVEL 1
+#endif
+
+namespace slog
+{
+    namespace lite
+    {
+        // Names of a call site, the library attaches its own call site on first use
+        struct Site
+        {
+            const char *func_name;
+            const char *file_name;
+            const char *args_name; // nullptr for SENTRY, SACTION and argument checks
+            int line_no;
+            mutable std::atomic<void *> impl;
+        };
+
+        SLOG_API bool shouldLog(CPLErr level);
+
+        // Level written or kept by the flight recorder
+        SLOG_API bool shouldRecord(CPLErr level);
+
+        SLOG_API void info(CPLErr level, int err_no, const char *format, ...) SLOG_PRINTF(3, 4);
+
+        SLOG_API void logAction(const Site &site);
+
+        SLOG_API void invalid(const Site &site, const char *arg_name);
+
+        // Outcome of VALIDATE_ARGUMENT, the same fields as slog::Validation
+        struct Validation
+        {
+            size_t invalid; // Bad elements, 0 when the argument is fine
+            size_t first;   // Index of the first bad element, size when there is none
+            size_t size;    // Elements checked, 0 for a single value or an empty range
+        };
+
+        SLOG_API void invalid(const Site &site, const char *arg_name, const Validation &validation);
+
+        // NaN and Inf in a range, checked by the SSE2 or AVX2 kernels of the library
+        SLOG_API Validation validateRange(const float *data, size_t size);
+
+        SLOG_API Validation validateRange(const double *data, size_t size);
+
+        // Times a decorated call or a block until it is destroyed
+        class SLOG_API Scope
+        {
+        private:
+            alignas(16) unsigned char _state[SLOG_LITE_SCOPE_SIZE];
+
+        public:
+            enum Kind
+            {
+                Call,
+                Block
+            };
+
+            Scope(const Site &site, Kind kind);
+            ~Scope();
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+            void fail(const char *message);
+            void fatal();
+        };
+
+        // Returned by a decorated call that threw, the values of NaN<T>() in slog.h
+        template <typename T, typename = void>
+        struct FailValue
+        {
+            static T get()
+            {
+                return T();
+            }
+        };
+
+        template <typename T>
+        struct FailValue<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+        {
+            static T get()
+            {
+                return std::numeric_limits<T>::min();
+            }
+        };
+
+        template <typename T>
+        struct FailValue<T, std::enable_if_t<std::is_floating_point<T>::value>>
+        {
+            static T get()
+            {
+                return std::numeric_limits<T>::quiet_NaN();
+            }
+        };
+
+        template <>
+        struct FailValue<CPLErr>
+        {
+            static CPLErr get()
+            {
+                return CE_Failure;
+            }
+        };
+
+        template <typename T>
+        bool isInvalid(const T &value)
+        {
+            return value == FailValue<T>::get();
+        }
+
+        inline bool isInvalid(float value)
+        {
+            return std::isnan(value);
+        }
+
+        inline bool isInvalid(double value)
+        {
+            return std::isnan(value);
+        }
+
+        inline bool isInvalid(long double value)
+        {
+            return std::isnan(value);
+        }
+
+        // Elements checked in bulk, characters and bool keep the comparison of the whole container
+        template <typename E>
+        struct BulkElement
+            : std::integral_constant<bool, std::is_floating_point<E>::value ||
+                                               (std::is_integral<E>::value && !std::is_same<E, bool>::value &&
+                                                !std::is_same<E, char>::value && !std::is_same<E, signed char>::value &&
+                                                !std::is_same<E, unsigned char>::value &&
+                                                !std::is_same<E, wchar_t>::value && !std::is_same<E, char16_t>::value &&
+                                                !std::is_same<E, char32_t>::value)>
+        {
+        };
+
+        template <typename T>
+        using ElementOf = std::remove_cv_t<std::remove_pointer_t<decltype(std::declval<const T &>().data())>>;
+
+        template <typename T, typename = void>
+        struct IsBulk : std::false_type
+        {
+        };
+
+        template <typename T>
+        struct IsBulk<T, decltype((void)std::declval<const T &>().data(), (void)std::declval<const T &>().size())>
+            : BulkElement<ElementOf<T>>
+        {
+        };
+
+        // Integer elements equal to FailValue<T>::get() are bad, float and double go to the library
+        template <typename T>
+        Validation validateRange(const T *data, size_t size)
+        {
+            Validation result = {0, size, size};
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (data[i] == FailValue<T>::get() && result.invalid++ == 0)
+                    result.first = i;
+            }
+            return result;
+        }
+
+        // An empty range counts as one bad value, like slog.h
+        template <typename T>
+        auto validate(const T &value) -> std::enable_if_t<IsBulk<T>::value, Validation>
+        {
+            if (value.size() == 0)
+                return Validation{1, 0, 0};
+            return validateRange(value.data(), value.size());
+        }
+
+        template <typename T, size_t N>
+        auto validate(const T (&values)[N]) -> std::enable_if_t<BulkElement<T>::value, Validation>
+        {
+            return validateRange(values, N);
+        }
+
+        template <typename T>
+        auto validate(const T &value) -> std::enable_if_t<!IsBulk<T>::value, Validation>
+        {
+            return Validation{isInvalid(value) ? 1u : 0u, 0, 0};
+        }
+
+        // Calls func in a Scope, the only template instantiated per signature
+        template <typename FUNC, typename... ARGS>
+        auto run(const Site &site, const FUNC &func, ARGS &&...args) -> decltype(func(std::forward<ARGS>(args)...))
+        {
+            typedef decltype(func(std::forward<ARGS>(args)...)) RET;
+            Scope scope(site, Scope::Call);
+            try
+            {
+                return func(std::forward<ARGS>(args)...);
+            }
+            catch (const std::exception &ex)
+            {
+                scope.fail(ex.what());
+            }
+            catch (...)
+            {
+                scope.fatal();
+            }
+            return FailValue<RET>::get();
+        }
+
+        template <typename FUNC>
+        struct Decorated
+        {
+            const Site *site;
+            FUNC func;
+
+            template <typename... ARGS>
+            auto operator()(ARGS &&...args) const -> decltype(func(std::forward<ARGS>(args)...))
+            {
+                return run(*site, func, std::forward<ARGS>(args)...);
+            }
+        };
+
+        template <typename FUNC>
+        Decorated<FUNC> decorate(const Site &site, FUNC func)
+        {
+            return Decorated<FUNC>{&site, func};
+        }
+
+        template <typename CLS, typename PMF>
+        struct Member
+        {
+            CLS *obj;
+            PMF func;
+
+            template <typename... ARGS>
+            auto operator()(ARGS &&...args) const -> decltype((obj->*func)(std::forward<ARGS>(args)...))
+            {
+                return (obj->*func)(std::forward<ARGS>(args)...);
+            }
+        };
+
+        template <typename CLS, typename PMF>
+        Member<CLS, PMF> member(CLS *obj, PMF func)
+        {
+            return Member<CLS, PMF>{obj, func};
+        }
+    }
+}
+
+#define SLOG_LITE_SITE(func_name, args_name)                                                 \
+    ([]() -> const slog::lite::Site & {                                                      \
+        static const slog::lite::Site site = {func_name, __FILE__, args_name, __LINE__, {}}; \
+        return site;                                                                         \
+    }())
+
+// The library includes slog.h first, its macros are kept
+#ifndef _SLOG_H_
+
+// CE_Fatal always reaches the library, which ends the program even when the record is filtered out
+#define SINFO(eErrClass, err_no, ...)                                                                    \
+    do                                                                                                   \
+    {                                                                                                    \
+        if ((static_cast<int>(eErrClass) >= SLOG_ACTIVE_LEVEL && slog::lite::shouldRecord(eErrClass)) || \
+            eErrClass == CE_Fatal)                                                                       \
+            slog::lite::info(eErrClass, err_no, __VA_ARGS__);                                            \
+    } while (0)
+
+// SINFO formats through vsnprintf here, runtime formats need nothing else
+#define SINFO_RT SINFO
+
+#define VALIDATE_ARGUMENT0(arg, func)                                                                \
+    do                                                                                               \
+    {                                                                                                \
+        slog::lite::Validation slog_validation = slog::lite::validate(arg);                          \
+        if (slog_validation.invalid != 0)                                                            \
+        {                                                                                            \
+            static const slog::lite::Site slog_check_site = {func, __FILE__, nullptr, __LINE__, {}}; \
+            slog::lite::invalid(slog_check_site, #arg, slog_validation);                             \
+            return;                                                                                  \
+        }                                                                                            \
+    } while (0)
+
+#define VALIDATE_ARGUMENT1(arg, func, ret)                                                           \
+    do                                                                                               \
+    {                                                                                                \
+        slog::lite::Validation slog_validation = slog::lite::validate(arg);                          \
+        if (slog_validation.invalid != 0)                                                            \
+        {                                                                                            \
+            static const slog::lite::Site slog_check_site = {func, __FILE__, nullptr, __LINE__, {}}; \
+            slog::lite::invalid(slog_check_site, #arg, slog_validation);                             \
+            return ret;                                                                              \
+        }                                                                                            \
+    } while (0)
+
+#define SLOG_CONCAT_(a, b) a##b
+#define SLOG_CONCAT(a, b) SLOG_CONCAT_(a, b)
+
+#if defined(_ENABLE_SLOG) && SLOG_ACTIVE_LEVEL <= 4
+
+#define SENTRY                                                                                       \
+    static const slog::lite::Site slog_entry_site = {__FUNCTION__, __FILE__, nullptr, __LINE__, {}}; \
+    slog::lite::Scope slog_entry_scope(slog_entry_site, slog::lite::Scope::Block);                   \
+    try                                                                                              \
+    {
+
+#define SLEAVE(ret)                       \
+    }                                     \
+    catch (const std::exception &ex)      \
+    {                                     \
+        slog_entry_scope.fail(ex.what()); \
+        return ret;                       \
+    }                                     \
+    catch (...)                           \
+    {                                     \
+        slog_entry_scope.fatal();         \
+        return ret;                       \
+    }
+
+#define SSCOPE(name)                                             \
+    slog::lite::Scope SLOG_CONCAT(slog_scope_, __LINE__)(        \
+        SLOG_LITE_SITE(name, nullptr), slog::lite::Scope::Block)
+
+#define SFUNC_DEC(func) slog::lite::decorate(SLOG_LITE_SITE(#func, "..."), &func)
+
+#define SFUNC_MEM_DEC(obj, func) \
+    slog::lite::decorate(SLOG_LITE_SITE(#func, "..."), slog::lite::member(&obj, &func))
+
+#define SFUNC_RUN(func, ...) slog::lite::decorate(SLOG_LITE_SITE(#func, #__VA_ARGS__), &func)(__VA_ARGS__)
+
+#define SFUNC_MEM_RUN(obj, func, ...) \
+    slog::lite::decorate(SLOG_LITE_SITE(#func, #__VA_ARGS__), slog::lite::member(&obj, &func))(__VA_ARGS__)
+
+#if SLOG_ACTIVE_LEVEL <= 1
+#define SACTION(action) ((void)slog::lite::logAction(SLOG_LITE_SITE(#action, nullptr)), (action))
+#else
+#define SACTION(action) action
+#endif
+
+#else
+
+#define SENTRY
+#define SLEAVE(result)
+#define SSCOPE(name)
+#define SFUNC_DEC(func) func
+#define SFUNC_MEM_DEC(obj, func) slog::lite::member(&obj, &func)
+#define SFUNC_RUN(func, ...) func(__VA_ARGS__)
+#define SFUNC_MEM_RUN(obj, func, ...) slog::lite::member(&obj, &func)(__VA_ARGS__)
+#define SACTION(action) action
+
+#endif // _ENABLE_SLOG
+
+#endif // _SLOG_H_
+
+#endif // _SLOG_LITE_H_
@@ -0,0 +1,159 @@
+/*
+ @ brief:   Turn a binary slog file back into the text layout
+ @ usage:   slog_decode [-ms | -us] [-utc] file
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "slog.h"
+
+struct SiteText
+{
+    std::string func_name;
+    std::string file_name;
+    std::string args_name;
+    bool has_args;
+    slog::CallSite site;
+};
+
+class Reader
+{
+private:
+    FILE *_file;
+
+public:
+    explicit Reader(FILE *file)
+        : _file(file)
+    {
+    }
+    template <typename T>
+    bool get(T &value)
+    {
+        return fread(&value, sizeof(T), 1, _file) == 1;
+    }
+    bool getString(std::string &str, bool &present)
+    {
+        uint16_t len;
+        if (!get(len))
+            return false;
+        present = (len != 0xFFFF);
+        str.clear();
+        if (!present)
+            return true;
+        str.resize(len);
+        return len == 0 || fread(&str[0], 1, len, _file) == len;
+    }
+};
+
+// Writes every line of an event to stdout as it is rendered
+struct PrintLine
+{
+    template <typename FMT, typename... ARGS>
+    void operator()(CPLErr level, int err_no, FMT format, const ARGS &...args) const
+    {
+        slog::detail::RecordBuffer &record = slog::detail::recordBuffer();
+        record.clear();
+        record.line(level, err_no, format, args...);
+        fwrite(record.data(), 1, record.size(), stdout);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-ms") == 0)
+            slog::setTimePrecision(slog::TimePrecision::Milli);
+        else if (std::strcmp(argv[i], "-us") == 0)
+            slog::setTimePrecision(slog::TimePrecision::Micro);
+        else if (std::strcmp(argv[i], "-utc") == 0)
+            slog::setTimeUTC(true);
+        else
+            path = argv[i];
+    }
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: %s [-ms | -us] [-utc] file\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Can not open %s\n", path);
+        return 1;
+    }
+
+    Reader in(file);
+    char magic[8];
+    uint32_t order = 0;
+    uint32_t version = 0;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        std::memcmp(magic, SLOG_BINARY_MAGIC, sizeof(magic)) != 0 ||
+        !in.get(order) || !in.get(version))
+    {
+        fprintf(stderr, "%s is not a binary slog file\n", path);
+        return 1;
+    }
+    if (order != SLOG_BINARY_ORDER || version != SLOG_BINARY_VERSION)
+    {
+        fprintf(stderr, "%s was written with another byte order or version (%u)\n", path, version);
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, std::unique_ptr<SiteText>> sites;
+    std::string message;
+    slog::BinaryTag tag;
+    while (in.get(tag))
+    {
+        if (tag == slog::BinaryTag::Site)
+        {
+            std::unique_ptr<SiteText> text(new SiteText());
+            uint32_t id;
+            int32_t line;
+            bool present;
+            if (!in.get(id) || !in.get(line) ||
+                !in.getString(text->func_name, present) ||
+                !in.getString(text->file_name, present) ||
+                !in.getString(text->args_name, text->has_args))
+                break;
+            text->site.func_name = text->func_name.c_str();
+            text->site.file_name = text->file_name.c_str();
+            text->site.args_name = text->has_args ? text->args_name.c_str() : nullptr;
+            text->site.line_no = line;
+            sites[id] = std::move(text);
+        }
+        else if (tag == slog::BinaryTag::Event)
+        {
+            slog::Event event = {};
+            uint32_t id;
+            bool present = false;
+            if (!in.get(event.kind) || !in.get(id) || !in.get(event.time) || !in.get(event.value))
+                break;
+            if (slog::eventHasMessage(event.kind))
+            {
+                if (!in.getString(message, present))
+                    break;
+            }
+            auto it = sites.find(id);
+            if (it == sites.end())
+            {
+                fprintf(stderr, "Event of unknown call site %u\n", id);
+                return 1;
+            }
+            event.site = &it->second->site;
+            event.message = present ? message.c_str() : nullptr;
+            slog::renderEvent(PrintLine(), event);
+        }
+        else
+        {
+            fprintf(stderr, "Corrupted record (tag %d)\n", static_cast<int>(tag));
+            return 1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
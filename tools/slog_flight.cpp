@@ -0,0 +1,152 @@
+/*
+ @ brief:   Dump the records kept by a flight recorder file, also after the process crashed
+ @ usage:   slog_flight [-n count] [-ms | -us] [-utc] file
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "slog.h"
+
+struct SiteText
+{
+    std::string func_name;
+    std::string file_name;
+    std::string args_name;
+    slog::CallSite site;
+};
+
+// Writes every line of an event to stdout as it is rendered
+struct PrintLine
+{
+    template <typename FMT, typename... ARGS>
+    void operator()(CPLErr level, int err_no, FMT format, const ARGS &...args) const
+    {
+        slog::detail::RecordBuffer &record = slog::detail::recordBuffer();
+        record.clear();
+        record.line(level, err_no, format, args...);
+        fwrite(record.data(), 1, record.size(), stdout);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    size_t count = static_cast<size_t>(-1);
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "-ms") == 0)
+            slog::setTimePrecision(slog::TimePrecision::Milli);
+        else if (std::strcmp(argv[i], "-us") == 0)
+            slog::setTimePrecision(slog::TimePrecision::Micro);
+        else if (std::strcmp(argv[i], "-utc") == 0)
+            slog::setTimeUTC(true);
+        else
+            path = argv[i];
+    }
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: %s [-n count] [-ms | -us] [-utc] file\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Can not open %s\n", path);
+        return 1;
+    }
+
+    // Read as 64 bit words so the records are aligned like in the mapping
+    std::vector<uint64_t> words;
+    uint64_t word[512];
+    size_t got;
+    while ((got = fread(word, sizeof(uint64_t), 512, file)) > 0)
+        words.insert(words.end(), word, word + got);
+    fclose(file);
+    const char *data = reinterpret_cast<const char *>(words.data());
+    size_t size = words.size() * sizeof(uint64_t);
+
+    const slog::detail::FlightHeader *header = reinterpret_cast<const slog::detail::FlightHeader *>(data);
+    if (size < sizeof(*header) || std::memcmp(header->magic, SLOG_FLIGHT_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "%s is not a flight recorder file\n", path);
+        return 1;
+    }
+    if (header->order != SLOG_FLIGHT_ORDER || header->version != SLOG_FLIGHT_VERSION ||
+        header->text_size != SLOG_FLIGHT_TEXT_SIZE)
+    {
+        fprintf(stderr, "%s was written with another byte order or version (%u)\n", path, header->version);
+        return 1;
+    }
+    size_t expected = sizeof(slog::detail::FlightHeader) + header->sites * sizeof(slog::detail::FlightSite) +
+                      header->slots * sizeof(slog::detail::FlightSlot);
+    if (size < expected || header->slots == 0)
+    {
+        fprintf(stderr, "%s is truncated\n", path);
+        return 1;
+    }
+    const slog::detail::FlightSite *sites = reinterpret_cast<const slog::detail::FlightSite *>(header + 1);
+    const slog::detail::FlightSlot *slots = reinterpret_cast<const slog::detail::FlightSlot *>(sites + header->sites);
+
+    // Complete records in the order they were claimed, a slot overwritten while read is skipped
+    std::vector<const slog::detail::FlightSlot *> records;
+    for (uint32_t i = 0; i < header->slots; ++i)
+    {
+        uint64_t seq = slots[i].seq.load(std::memory_order_relaxed);
+        if (seq != 0 && (seq & SLOG_FLIGHT_FILLING) == 0 && ((seq - 1) & (header->slots - 1)) == i)
+            records.push_back(&slots[i]);
+    }
+    std::sort(records.begin(), records.end(),
+              [](const slog::detail::FlightSlot *a, const slog::detail::FlightSlot *b)
+              { return a->seq.load(std::memory_order_relaxed) < b->seq.load(std::memory_order_relaxed); });
+    if (records.size() > count)
+        records.erase(records.begin(), records.end() - static_cast<std::ptrdiff_t>(count));
+    printf("# Process %d, %llu records written, last %zu kept\n", header->pid,
+           static_cast<unsigned long long>(header->next.load(std::memory_order_relaxed)), records.size());
+
+    std::vector<std::unique_ptr<SiteText>> texts(header->sites);
+    SiteText unknown;
+    unknown.func_name = "?";
+    unknown.file_name = "?";
+    unknown.site.func_name = unknown.func_name.c_str();
+    unknown.site.file_name = unknown.file_name.c_str();
+    unknown.site.args_name = "";
+    unknown.site.line_no = 0;
+    for (const slog::detail::FlightSlot *slot : records)
+    {
+        std::string text(slot->text, std::min<size_t>(slot->size, sizeof(slot->text) - 1));
+        if (slot->kind == 0)
+        {
+            PrintLine()(static_cast<CPLErr>(slot->level), 0, SLOG_FORMAT("%s"), text.c_str());
+            continue;
+        }
+        const slog::CallSite *site = &unknown.site;
+        if (slot->site < header->sites && sites[slot->site].state.load(std::memory_order_relaxed) == 2)
+        {
+            std::unique_ptr<SiteText> &entry = texts[slot->site];
+            if (entry == nullptr)
+            {
+                const slog::detail::FlightSite &names = sites[slot->site];
+                entry.reset(new SiteText());
+                entry->func_name.assign(names.func, strnlen(names.func, sizeof(names.func)));
+                entry->file_name.assign(names.file, strnlen(names.file, sizeof(names.file)));
+                entry->args_name.assign(names.args, strnlen(names.args, sizeof(names.args)));
+                entry->site.func_name = entry->func_name.c_str();
+                entry->site.file_name = entry->file_name.c_str();
+                entry->site.args_name = entry->args_name.c_str();
+                entry->site.line_no = names.line;
+            }
+            site = &entry->site;
+        }
+        slog::Event event = {static_cast<slog::EventKind>(slot->kind), site, slot->time, slot->value,
+                             text.empty() ? nullptr : text.c_str(), nullptr};
+        slog::renderEvent(PrintLine(), event);
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ @ brief:   Text of a file written by slog::CompressedFileSink, block by block
+ @ usage:   slog_unpack [-l] [-b block] [-n count] [-f] file
+            -b starts at a block, negative counts from the end; -f keeps waiting for new blocks like tail -f
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "slog.h"
+
+struct Block
+{
+    int64_t offset; // Of the block header
+    slog::detail::BlockHeader header;
+};
+
+// Reads the header of the block at offset, false at the end of the file or on a partly written block
+bool readHeader(FILE *file, int64_t offset, int64_t file_size, Block &block)
+{
+    if (offset + static_cast<int64_t>(sizeof(block.header)) > file_size)
+        return false;
+    fseek(file, static_cast<long>(offset), SEEK_SET);
+    if (fread(&block.header, sizeof(block.header), 1, file) != 1)
+        return false;
+    block.offset = offset;
+    return offset + static_cast<int64_t>(sizeof(block.header)) + block.header.packed_size <= file_size;
+}
+
+int64_t sizeOf(FILE *file)
+{
+    fseek(file, 0, SEEK_END);
+    return static_cast<int64_t>(ftell(file));
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = nullptr;
+    bool list = false;
+    bool follow = false;
+    long first = 0;
+    size_t count = static_cast<size_t>(-1);
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-l") == 0)
+            list = true;
+        else if (std::strcmp(argv[i], "-f") == 0)
+            follow = true;
+        else if (std::strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+            first = std::strtol(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else
+            path = argv[i];
+    }
+    if (path == nullptr)
+    {
+        fprintf(stderr, "usage: %s [-l] [-b block] [-n count] [-f] file\n", argv[0]);
+        return 2;
+    }
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Can not open %s\n", path);
+        return 1;
+    }
+    slog::detail::BlockFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, SLOG_BLOCK_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "%s is not a compressed slog file\n", path);
+        return 1;
+    }
+    if (header.order != SLOG_BLOCK_ORDER || header.version != SLOG_BLOCK_VERSION)
+    {
+        fprintf(stderr, "%s was written with another byte order or version (%u)\n", path, header.version);
+        return 1;
+    }
+
+    // Index of the complete blocks, only their headers are read
+    std::vector<Block> blocks;
+    int64_t file_size = sizeOf(file);
+    int64_t offset = sizeof(header);
+    Block block;
+    while (readHeader(file, offset, file_size, block))
+    {
+        if (block.header.tag != SLOG_BLOCK_TAG)
+        {
+            fprintf(stderr, "Damaged block at offset %lld\n", static_cast<long long>(offset));
+            return 1;
+        }
+        blocks.push_back(block);
+        offset += sizeof(block.header) + block.header.packed_size;
+    }
+
+    if (list)
+    {
+        uint64_t raw = 0, packed = 0;
+        printf("%8s %14s %10s %10s %7s  %s\n", "block", "offset", "raw", "packed", "ratio", "codec");
+        for (size_t i = 0; i < blocks.size(); ++i)
+        {
+            const slog::detail::BlockHeader &h = blocks[i].header;
+            static const char *codecs[] = {"stored", "lz", "zlib"};
+            printf("%8zu %14lld %10u %10u %7.2f  %s\n", i, static_cast<long long>(blocks[i].offset), h.raw_size,
+                   h.packed_size, h.packed_size == 0 ? 0.0 : static_cast<double>(h.raw_size) / h.packed_size,
+                   h.codec < 3 ? codecs[h.codec] : "?");
+            raw += h.raw_size;
+            packed += sizeof(h) + h.packed_size;
+        }
+        printf("# %zu blocks, %llu bytes of text in %llu bytes, %.2f times smaller\n", blocks.size(),
+               static_cast<unsigned long long>(raw), static_cast<unsigned long long>(packed + sizeof(header)),
+               static_cast<double>(raw) / static_cast<double>(packed + sizeof(header)));
+        return 0;
+    }
+
+    size_t start = first >= 0 ? std::min(static_cast<size_t>(first), blocks.size())
+                              : blocks.size() - std::min(static_cast<size_t>(-first), blocks.size());
+    std::vector<char> packed, raw;
+    size_t shown = 0;
+    for (size_t i = start;; ++i)
+    {
+        if (i == blocks.size())
+        {
+            if (!follow || shown >= count)
+                break;
+            // Wait for the writer to add the next complete block
+            fflush(stdout);
+            while (!readHeader(file, offset, sizeOf(file), block))
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (block.header.tag != SLOG_BLOCK_TAG)
+            {
+                fprintf(stderr, "Damaged block at offset %lld\n", static_cast<long long>(offset));
+                return 1;
+            }
+            blocks.push_back(block);
+            offset += sizeof(block.header) + block.header.packed_size;
+        }
+        if (shown++ >= count)
+            break;
+        const slog::detail::BlockHeader &h = blocks[i].header;
+        packed.resize(h.packed_size);
+        raw.resize(h.raw_size);
+        fseek(file, static_cast<long>(blocks[i].offset + sizeof(h)), SEEK_SET);
+        if (fread(packed.data(), 1, packed.size(), file) != packed.size() ||
+            !slog::detail::decodeBlock(static_cast<slog::BlockCodec>(h.codec), packed.data(), packed.size(),
+                                       raw.data(), raw.size()))
+        {
+            fprintf(stderr, "Can not unpack block %zu\n", i);
+            return 1;
+        }
+        fwrite(raw.data(), 1, raw.size(), stdout);
+    }
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,353 @@
+/*
+ @ brief:   Live view of the call sites published by slog::openSharedStats, over one or more processes
+ @ usage:   slogtop [-s calls | rate | failures | total | mean | p99 | max] [-n rows] [-d seconds] [-1] [pid ...]
+            While running, the first letter of a column sorts by it and q quits
+ */
+
+#ifdef _WIN32
+
+#include <cstdio>
+
+int main()
+{
+    fprintf(stderr, "slogtop needs POSIX shared memory\n");
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include "slog.h"
+
+enum class SortKey
+{
+    Calls,
+    Rate,
+    Failures,
+    Total,
+    Mean,
+    P99,
+    Max
+};
+
+struct Row
+{
+    int pid;
+    uint32_t id;
+    std::string func;
+    std::string file;
+    int line;
+    uint64_t calls;
+    uint64_t failures;
+    uint64_t total; // ns
+    uint64_t max;
+    uint64_t p50;
+    uint64_t p99;
+    double rate; // Calls per second since the previous view
+};
+
+bool sortKey(char key, SortKey &sort)
+{
+    switch (key)
+    {
+    case 'c':
+        sort = SortKey::Calls;
+        return true;
+    case 'r':
+        sort = SortKey::Rate;
+        return true;
+    case 'f':
+        sort = SortKey::Failures;
+        return true;
+    case 't':
+        sort = SortKey::Total;
+        return true;
+    case 'm':
+        sort = SortKey::Mean;
+        return true;
+    case 'p':
+        sort = SortKey::P99;
+        return true;
+    case 'x':
+        sort = SortKey::Max;
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool sortName(const char *name, SortKey &sort)
+{
+    static const char *names[] = {"calls", "rate", "failures", "total", "mean", "p99", "max"}; // In SortKey order
+    for (int i = 0; i < 7; ++i)
+    {
+        if (std::strcmp(name, names[i]) == 0)
+        {
+            sort = static_cast<SortKey>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+double sortValue(const Row &row, SortKey sort)
+{
+    uint64_t timed = row.calls - row.failures;
+    switch (sort)
+    {
+    case SortKey::Calls:
+        return static_cast<double>(row.calls);
+    case SortKey::Rate:
+        return row.rate;
+    case SortKey::Failures:
+        return static_cast<double>(row.failures);
+    case SortKey::Total:
+        return static_cast<double>(row.total);
+    case SortKey::Mean:
+        return timed == 0 ? 0.0 : static_cast<double>(row.total) / timed;
+    case SortKey::P99:
+        return static_cast<double>(row.p99);
+    case SortKey::Max:
+        return static_cast<double>(row.max);
+    }
+    return 0.0;
+}
+
+// Processes with statistics in /dev/shm, ones that are gone are left out
+std::vector<int> findProcesses()
+{
+    std::vector<int> pids;
+    DIR *dir = opendir("/dev/shm");
+    if (dir == nullptr)
+        return pids;
+    const char *prefix = SLOG_SHARED_PREFIX + 1;
+    size_t prefix_len = std::strlen(prefix);
+    while (dirent *entry = readdir(dir))
+    {
+        if (std::strncmp(entry->d_name, prefix, prefix_len) != 0)
+            continue;
+        char *end;
+        long pid = std::strtol(entry->d_name + prefix_len, &end, 10);
+        if (*end == '\0' && pid > 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM))
+            pids.push_back(static_cast<int>(pid));
+    }
+    closedir(dir);
+    std::sort(pids.begin(), pids.end());
+    return pids;
+}
+
+// Reads the call sites of one process, false if it publishes nothing readable
+bool readProcess(int pid, std::vector<Row> &rows)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%d", SLOG_SHARED_PREFIX, pid);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(slog::detail::SharedHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return false;
+    const slog::detail::SharedHeader *header = static_cast<const slog::detail::SharedHeader *>(base);
+    bool valid = std::memcmp(header->magic, SLOG_SHARED_MAGIC, 8) == 0 && header->order == SLOG_SHARED_ORDER &&
+                 header->version == SLOG_SHARED_VERSION && header->buckets == slog::detail::kHistogramBuckets &&
+                 size >= sizeof(*header) + header->sites * sizeof(slog::detail::SharedSite);
+    if (!valid)
+    {
+        munmap(base, size);
+        return false;
+    }
+    const slog::detail::SharedSite *sites = reinterpret_cast<const slog::detail::SharedSite *>(header + 1);
+    uint64_t buckets[slog::detail::kHistogramBuckets];
+    for (uint32_t i = 0; i < header->sites; ++i)
+    {
+        const slog::detail::SharedSite &site = sites[i];
+        if (site.state.load(std::memory_order_acquire) != 2)
+            continue;
+        Row row;
+        row.pid = pid;
+        row.id = i;
+        row.func.assign(site.func, strnlen(site.func, sizeof(site.func)));
+        row.file.assign(site.file, strnlen(site.file, sizeof(site.file)));
+        row.line = site.line;
+        row.calls = site.calls.load(std::memory_order_relaxed);
+        row.failures = site.failures.load(std::memory_order_relaxed);
+        row.total = site.total.load(std::memory_order_relaxed);
+        row.max = site.max.load(std::memory_order_relaxed);
+        uint64_t min = site.min.load(std::memory_order_relaxed);
+        uint64_t timed = 0;
+        for (int j = 0; j < slog::detail::kHistogramBuckets; ++j)
+        {
+            buckets[j] = site.buckets[j].load(std::memory_order_relaxed);
+            timed += buckets[j];
+        }
+        // Counters are read one by one while calls go on, keep the order statistics consistent
+        min = std::min(min, row.max);
+        row.p50 = timed == 0 ? 0 : slog::detail::percentile(buckets, timed, 0.5, min, row.max);
+        row.p99 = timed == 0 ? 0 : slog::detail::percentile(buckets, timed, 0.99, min, row.max);
+        row.rate = 0.0;
+        rows.push_back(row);
+    }
+    munmap(base, size);
+    return true;
+}
+
+// Leaves the terminal as it was, also on Ctrl-C
+struct RawTerminal
+{
+    static termios &saved()
+    {
+        static termios state;
+        return state;
+    }
+    static bool &active()
+    {
+        static bool on = false;
+        return on;
+    }
+
+    static void restore()
+    {
+        if (active())
+            tcsetattr(STDIN_FILENO, TCSANOW, &saved());
+        active() = false;
+    }
+
+    static void quit(int)
+    {
+        restore();
+        printf("\n");
+        std::_Exit(0);
+    }
+
+    static void enter()
+    {
+        if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved()) != 0)
+            return;
+        termios raw = saved();
+        raw.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO));
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        active() = true;
+        std::atexit(restore);
+        signal(SIGINT, quit);
+        signal(SIGTERM, quit);
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    SortKey sort = SortKey::Total;
+    size_t count = 20;
+    double delay = 1.0;
+    bool once = false;
+    std::vector<int> pids;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc && sortName(argv[i + 1], sort))
+            ++i;
+        else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            delay = std::max(0.1, std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "-1") == 0)
+            once = true;
+        else if (argv[i][0] >= '0' && argv[i][0] <= '9')
+            pids.push_back(std::atoi(argv[i]));
+        else
+        {
+            fprintf(stderr,
+                    "usage: %s [-s calls | rate | failures | total | mean | p99 | max] [-n rows] [-d seconds] [-1] [pid ...]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (!once)
+        RawTerminal::enter();
+
+    std::map<std::pair<int, uint32_t>, uint64_t> previous; // Calls of each site at the last view
+    std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+    for (;;)
+    {
+        std::vector<int> shown = pids.empty() ? findProcesses() : pids;
+        std::vector<Row> rows;
+        int attached = 0;
+        for (int pid : shown)
+            attached += readProcess(pid, rows) ? 1 : 0;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        last = now;
+        std::map<std::pair<int, uint32_t>, uint64_t> current;
+        for (Row &row : rows)
+        {
+            std::pair<int, uint32_t> key(row.pid, row.id);
+            auto it = previous.find(key);
+            if (it != previous.end() && seconds > 0.0 && row.calls >= it->second)
+                row.rate = static_cast<double>(row.calls - it->second) / seconds;
+            current[key] = row.calls;
+        }
+        previous.swap(current);
+        std::stable_sort(rows.begin(), rows.end(), [sort](const Row &a, const Row &b)
+                         { return sortValue(a, sort) > sortValue(b, sort); });
+        if (rows.size() > count)
+            rows.resize(count);
+
+        if (!once)
+            printf("\x1b[H\x1b[2J");
+        char time_str[SLOG_TIME_BUFFER_SIZE];
+        slog::formatTime(time_str, sizeof(time_str));
+        printf("slogtop - %s, %d processes, sort with c r f t m p x, q to quit\n\n", time_str, attached);
+        printf("%8s %12s %10s %8s %12s %10s %10s %10s %10s  %s\n", "pid", "calls", "calls/s", "failures",
+               "total(ms)", "mean(us)", "p50(us)", "p99(us)", "max(us)", "function");
+        for (const Row &row : rows)
+        {
+            uint64_t timed = row.calls - row.failures;
+            printf("%8d %12llu %10.1f %8llu %12.3f %10.3f %10.3f %10.3f %10.3f  %s (%s:%d)\n", row.pid,
+                   static_cast<unsigned long long>(row.calls), row.rate,
+                   static_cast<unsigned long long>(row.failures), row.total / 1e6,
+                   timed == 0 ? 0.0 : row.total / 1e3 / timed, row.p50 / 1e3, row.p99 / 1e3,
+                   timed == 0 ? 0.0 : row.max / 1e3, row.func.c_str(), row.file.c_str(), row.line);
+        }
+        fflush(stdout);
+        if (once)
+            break;
+
+        // Wait for the next view, a key press sorts or quits at once
+        pollfd input = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&input, RawTerminal::active() ? 1 : 0, static_cast<int>(delay * 1000)) > 0)
+        {
+            char key;
+            if (read(STDIN_FILENO, &key, 1) == 1)
+            {
+                if (key == 'q')
+                    break;
+                sortKey(key, sort);
+            }
+        }
+    }
+    RawTerminal::restore();
+    return 0;
+}
+
+#endif